@@ -0,0 +1,112 @@
+#pragma once
+#include "../include/SharedTypes.hpp"
+#include "../include/RequestRing.hpp"
+#include "../include/ClientIndex.hpp"
+#include "../include/WaitWord.hpp"
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+// The client side of the protocol for the benchmarks and tests: requests go
+// through the RequestRing, replies are read straight off the slot's ring.
+// One request is in flight at a time, so anything that is not the reply
+// being waited for (a stale reply or a pushed event) is dropped.
+
+constexpr int SESSION_TIMEOUT_MS = 5000;
+
+class Session {
+public:
+    Session(SharedMemoryRoot* root, const std::string& login, int timeout_ms = SESSION_TIMEOUT_MS)
+        : root(root), ring(root), login(login), timeout_ms(timeout_ms), slot(nullptr), slot_index(-1), token(0),
+          next_seq(1) {}
+    
+    // Sends MSG_REGISTER and waits for the slot to appear and the reply.
+    bool register_login();
+    
+    uint32_t send(MsgType type, const RequestBody* body = nullptr);
+    bool receive(uint32_t seq, Response& out);
+    bool call(MsgType type, const RequestBody* body, Response& out) { return receive(send(type, body), out); }
+    
+    // MSG_QUIT has no reply.
+    void quit() { send(MSG_QUIT); }
+
+private:
+    SharedMemoryRoot* root;
+    RequestRing ring;
+    std::string login;
+    int timeout_ms;
+    ClientSlot* slot;
+    int32_t slot_index;
+    uint32_t token;
+    uint32_t next_seq;
+};
+
+// Every request counts as a heartbeat.
+inline uint32_t Session::send(MsgType type, const RequestBody* body) {
+    uint64_t ticket;
+    Message* m;
+    while (!(m = ring.reserve(ticket))) {
+        std::this_thread::yield();
+    }
+    
+    uint32_t seq = next_seq++;
+    strncpy(m->from, login.c_str(), LOGIN_MAX - 1);
+    m->from[LOGIN_MAX - 1] = '\0';
+    strcpy(m->to, "server");
+    m->pid = getpid();
+    m->seq = seq;
+    m->slot = slot_index;
+    m->token = token;
+    m->type = type;
+    if (body) {
+        m->body = *body;
+    }
+    ring.commit(ticket);
+    
+    if (slot) {
+        slot->heartbeat_ns.store(monotonic_ns(), std::memory_order_relaxed);
+    }
+    return seq;
+}
+
+inline bool Session::receive(uint32_t seq, Response& out) {
+    struct timespec deadline = monotonic_deadline(timeout_ms);
+    
+    while (true) {
+        uint32_t key = wait_prepare(slot->ready);
+        uint32_t head = slot->resp_head.load(std::memory_order_relaxed);
+        uint32_t tail = slot->resp_tail.load(std::memory_order_acquire);
+        
+        bool found = false;
+        for (; head != tail; head++) {
+            const Response& r = slot->responses[head & (RESP_RING_SIZE - 1)];
+            if (r.seq == seq && r.type != MSG_EVENT) {
+                out = r;
+                found = true;
+            }
+        }
+        slot->resp_head.store(head, std::memory_order_release);
+        if (found) return true;
+        
+        if (!wait_until(slot->ready, key, &deadline)) return false;
+    }
+}
+
+inline bool Session::register_login() {
+    uint32_t seq = send(MSG_REGISTER);
+    
+    ClientIndex index(root);
+    struct timespec deadline = monotonic_deadline(timeout_ms);
+    while (!slot) {
+        uint32_t key = wait_prepare(root->registrations);
+        slot = index.find(login.c_str());
+        if (!slot && !wait_until(root->registrations, key, &deadline)) return false;
+    }
+    
+    Response r;
+    if (!receive(seq, r) || r.status != ST_OK) return false;
+    slot_index = r.slot;
+    token = r.token;
+    return true;
+}
@@ -0,0 +1,118 @@
+#include "../include/SharedMemory.hpp"
+#include "Session.hpp"
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Client churn against a running server: every round forks clients that
+// register (every other one also creates a game), SIGKILLs them all and
+// waits for the server's reaper. Active clients and live games should fall
+// back to where they started after each round; a leak shows up as a count
+// that keeps climbing until registrations fail.
+//
+//   bench_churn [rounds] [clients]
+
+namespace {
+
+// Runs in the child: registers, optionally creates a game, writes 1 (or 0
+// on failure) to the pipe and waits to be killed.
+void run_child(const std::string& login, bool create, int ready_fd) {
+    auto report = [&](char ok) {
+        if (write(ready_fd, &ok, 1) != 1 || !ok) _exit(1);
+    };
+    
+    SharedMemory shm(false);
+    Session session(shm.root(), login);
+    if (!session.register_login()) report(0);
+    
+    if (create) {
+        RequestBody body;
+        strcpy(body.create.game_name, login.c_str());
+        body.create.max_players = 2;
+        Response r;
+        if (!session.call(MSG_CREATE_GAME, &body, r) || r.status != ST_OK) report(0);
+    }
+    
+    report(1);
+    while (true) {
+        pause();
+    }
+}
+
+int64_t live_games(StatsRegion* stats) {
+    return stats->games_by_state[GAME_WAITING].load() + stats->games_by_state[GAME_ACTIVE].load();
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 10;
+    int clients = argc > 2 ? atoi(argv[2]) : 50;
+    
+    SharedMemory shm(false, ShmConfig(), SHM_NAME, true);
+    StatsRegion* stats = shm.root()->stats();
+    int64_t base_clients = stats->active_clients.load();
+    int64_t base_games = live_games(stats);
+    
+    printf("%-6s %8s %8s %8s %8s %8s\n", "round", "started", "peak", "active", "games", "reaped");
+    
+    for (int round = 0; round < rounds; round++) {
+        int fds[2];
+        if (pipe(fds) == -1) {
+            perror("pipe");
+            return 1;
+        }
+        
+        std::vector<pid_t> pids;
+        for (int i = 0; i < clients; i++) {
+            std::string login = "churn-" + std::to_string(round) + "-" + std::to_string(i);
+            pid_t pid = fork();
+            if (pid == 0) {
+                close(fds[0]);
+                run_child(login, i % 2 == 0, fds[1]);
+            }
+            if (pid > 0) {
+                pids.push_back(pid);
+            }
+        }
+        close(fds[1]);
+        
+        int started = 0;
+        char ok;
+        for (size_t i = 0; i < pids.size() && read(fds[0], &ok, 1) == 1; i++) {
+            started += ok;
+        }
+        close(fds[0]);
+        int64_t peak = stats->active_clients.load();
+        
+        for (pid_t pid : pids) {
+            kill(pid, SIGKILL);
+        }
+        for (pid_t pid : pids) {
+            waitpid(pid, nullptr, 0);
+        }
+        
+        // The reaper scans every CLIENT_HEARTBEAT_MS; give it a few rounds.
+        auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(5 * CLIENT_HEARTBEAT_MS);
+        while (std::chrono::steady_clock::now() < until &&
+               (stats->active_clients.load() > base_clients || live_games(stats) > base_games)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        
+        printf("%-6d %8d %8lld %8lld %8lld %8llu\n", round, started, static_cast<long long>(peak),
+               static_cast<long long>(stats->active_clients.load()), static_cast<long long>(live_games(stats)),
+               static_cast<unsigned long long>(stats->reaped_clients.load()));
+        fflush(stdout);
+    }
+    
+    bool flat = stats->active_clients.load() <= base_clients && live_games(stats) <= base_games;
+    printf("%s\n", flat ? "capacity recovered" : "LEAK: clients or games not reclaimed");
+    return flat ? 0 : 1;
+}
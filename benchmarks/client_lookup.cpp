@@ -0,0 +1,66 @@
+#include "../include/ClientIndex.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+
+// Compares the old linear strcmp scan over the client table against the
+// shared-memory hash index, for a table of N registered clients.
+
+namespace {
+
+ClientSlot* scan(ClientSlot* slots, size_t n, const char* login) {
+    for (size_t i = 0; i < n; i++) {
+        if (slots[i].used && strcmp(slots[i].login, login) == 0) {
+            return &slots[i];
+        }
+    }
+    return nullptr;
+}
+
+template <typename Lookup>
+double measure(const char* name, size_t n, size_t lookups, Lookup lookup) {
+    char login[LOGIN_MAX];
+    uintptr_t sink = 0;
+    
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < lookups; i++) {
+        snprintf(login, sizeof(login), "player%zu", (i * 7919) % n);
+        sink += reinterpret_cast<uintptr_t>(lookup(login));
+    }
+    auto end = std::chrono::steady_clock::now();
+    
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / lookups;
+    std::cout << name << "  ns/lookup: " << ns << (sink ? "" : " (no hits)") << std::endl;
+    return ns;
+}
+
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4096;
+    size_t lookups = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+    
+    size_t capacity = 1;
+    while (capacity < 2 * n) capacity <<= 1;
+    
+    std::unique_ptr<ClientSlot[]> slots(new ClientSlot[n]());
+    std::unique_ptr<ClientIndexEntry[]> entries(new ClientIndexEntry[capacity]());
+    std::atomic<uint32_t> moves{0};
+    ClientIndex index(entries.get(), capacity, slots.get(), &moves);
+    
+    for (size_t i = 0; i < n; i++) {
+        slots[i].used = true;
+        snprintf(slots[i].login, LOGIN_MAX, "player%zu", i);
+        index.insert(slots[i].login, static_cast<int>(i));
+    }
+    
+    std::cout << "clients: " << n << ", lookups: " << lookups << std::endl;
+    double linear = measure("linear-scan", n, lookups, [&](const char* login) { return scan(slots.get(), n, login); });
+    double hashed = measure("hash-index ", n, lookups, [&](const char* login) { return index.find(login); });
+    std::cout << "speedup: " << linear / hashed << "x" << std::endl;
+    
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+// Compares two result files written by `bench_micro --json` and flags every
+// benchmark that got slower than the baseline by more than the threshold.
+// Exits with 1 when something regressed, so it can gate a script.
+//
+//   bench_compare baseline.json current.json [threshold_percent]
+
+namespace {
+
+// The files are flat {"name": ns, ...} objects; pick out the pairs.
+bool load(const char* path, std::map<std::string, double>& out) {
+    std::ifstream in(path);
+    if (!in) return false;
+    
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string text = buffer.str();
+    
+    size_t pos = 0;
+    while ((pos = text.find('"', pos)) != std::string::npos) {
+        size_t end = text.find('"', pos + 1);
+        size_t colon = text.find(':', end);
+        if (end == std::string::npos || colon == std::string::npos) break;
+        
+        out[text.substr(pos + 1, end - pos - 1)] = std::strtod(text.c_str() + colon + 1, nullptr);
+        pos = colon;
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0] << " baseline.json current.json [threshold_percent]" << std::endl;
+        return 2;
+    }
+    double threshold = argc > 3 ? std::strtod(argv[3], nullptr) : 10.0;
+    
+    std::map<std::string, double> baseline, current;
+    if (!load(argv[1], baseline) || !load(argv[2], current)) {
+        std::cerr << "cannot read result files" << std::endl;
+        return 2;
+    }
+    
+    int regressions = 0;
+    for (const auto& entry : current) {
+        auto it = baseline.find(entry.first);
+        if (it == baseline.end() || it->second <= 0) {
+            printf("%-16s %10.1f ns/op  (new)\n", entry.first.c_str(), entry.second);
+            continue;
+        }
+        
+        double change = (entry.second - it->second) / it->second * 100.0;
+        bool regressed = change > threshold;
+        regressions += regressed;
+        printf("%-16s %10.1f -> %10.1f ns/op  %+6.1f%%%s\n", entry.first.c_str(), it->second, entry.second,
+               change, regressed ? "  REGRESSION" : "");
+    }
+    
+    for (const auto& entry : baseline) {
+        if (!current.count(entry.first)) {
+            printf("%-16s missing from current results\n", entry.first.c_str());
+        }
+    }
+    
+    return regressions ? 1 : 0;
+}
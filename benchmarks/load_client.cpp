@@ -0,0 +1,277 @@
+#include "../include/SharedMemory.hpp"
+#include "../include/Dictionary.hpp"
+#include "Session.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Headless load generator: N player threads attach to a running server,
+// register, get into games (MSG_FIND_GAME, or create/join with --create),
+// play them out with a candidate-elimination solver and report round-trip latency per
+// MsgType.
+//
+// Candidates come from the same dictionary file the server was given.
+//
+//   bench_client [players] [games] [max_players] [--create] [--dict path] [--json path]
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int MAX_ATTEMPTS = 64;
+constexpr int TIMEOUT_MS = 5000;
+
+struct Options {
+    size_t players = 4;
+    size_t games = 10;
+    int max_players = 2;
+    bool create = false;
+    const char* dict = DEFAULT_DICTIONARY_PATH;
+    const char* json = nullptr;
+};
+
+// Latencies in microseconds, per MsgType.
+using Samples = std::map<uint8_t, std::vector<double>>;
+
+class Player {
+public:
+    Player(SharedMemoryRoot* root, size_t id)
+        : errors(0), id(id), session(root, "bench" + std::to_string(id)) {}
+    
+    bool call(MsgType type, const RequestBody* body, Response& out);
+    bool register_player();
+    bool enter_game(const Options& opt, size_t group, size_t round);
+    void play();
+    void quit() { session.quit(); }
+    
+    Samples samples;
+    size_t errors;
+
+private:
+    size_t id;
+    Session session;
+};
+
+bool Player::call(MsgType type, const RequestBody* body, Response& out) {
+    auto start = Clock::now();
+    bool ok = session.call(type, body, out);
+    if (ok) {
+        samples[type].push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    } else {
+        errors++;
+    }
+    return ok;
+}
+
+bool Player::register_player() {
+    auto start = Clock::now();
+    if (!session.register_login()) {
+        errors++;
+        return false;
+    }
+    
+    samples[MSG_REGISTER].push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    return true;
+}
+
+// Players are grouped max_players at a time. With --create the first player
+// of each group creates the round's game and the others join it by name.
+bool Player::enter_game(const Options& opt, size_t group, size_t round) {
+    RequestBody body;
+    Response r;
+    
+    if (!opt.create) {
+        body.find.max_players = opt.max_players;
+        return call(MSG_FIND_GAME, &body, r) && r.status == ST_OK;
+    }
+    
+    char name[LOGIN_MAX];
+    snprintf(name, sizeof(name), "bench-%zu-%zu", group, round);
+    
+    for (int tries = 0; tries < TIMEOUT_MS; tries++) {
+        if (id % opt.max_players == 0) {
+            strcpy(body.create.game_name, name);
+            body.create.max_players = opt.max_players;
+            if (!call(MSG_CREATE_GAME, &body, r)) return false;
+        } else {
+            strcpy(body.join.game_name, name);
+            if (!call(MSG_JOIN_GAME, &body, r)) return false;
+        }
+        if (r.status == ST_OK) return true;
+        
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+// Waits for the game to fill up, then guesses until solved or the game is
+// over. After each reply only the words that would have scored the same are
+// kept as candidates.
+void Player::play() {
+    Response r;
+    for (int polls = 0; polls < TIMEOUT_MS; polls++) {
+        if (!call(MSG_GAME_STATUS, nullptr, r) || r.status != ST_OK) break;
+        if (r.body.status.state != GAME_WAITING) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    
+    const Dictionary& dictionary = Dictionary::shared();
+    std::vector<PackedWord> candidates(dictionary.data(), dictionary.data() + dictionary.size());
+    std::rotate(candidates.begin(), candidates.begin() + id % candidates.size(), candidates.end());
+    std::vector<Score> scores(candidates.size());
+    
+    for (int attempt = 0; attempt < MAX_ATTEMPTS && !candidates.empty(); attempt++) {
+        PackedWord word = candidates.front();
+        RequestBody body;
+        unpack_word(word, body.guess.word);
+        if (!call(MSG_GUESS, &body, r) || r.status != ST_OK) break;
+        
+        const GuessResult& g = r.body.guess;
+        if (g.flags & GUESS_SOLVED) break;
+        
+        GuessScorer(word).score_batch(candidates.data(), candidates.size(), scores.data());
+        size_t kept = 0;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (scores[i].bulls == g.bulls && scores[i].cows == g.cows && candidates[i] != word) {
+                candidates[kept++] = candidates[i];
+            }
+        }
+        candidates.resize(kept);
+    }
+    
+    call(MSG_LEAVE_GAME, nullptr, r);
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * p))];
+}
+
+void report(const Options& opt, Samples& all, size_t errors, double seconds, std::ostream& out, bool json) {
+    size_t total = 0;
+    for (auto& entry : all) {
+        std::sort(entry.second.begin(), entry.second.end());
+        total += entry.second.size();
+    }
+    
+    if (!json) {
+        out << "players: " << opt.players << "  games/player: " << opt.games
+            << "  requests: " << total << "  errors: " << errors
+            << "  throughput: " << total / seconds << " req/s" << std::endl;
+        for (const auto& entry : all) {
+            const std::vector<double>& s = entry.second;
+            printf("  %-12s n=%-8zu p50=%9.1f us  p99=%9.1f us  p999=%9.1f us\n", msg_type_name(entry.first),
+                   s.size(), percentile(s, 0.5), percentile(s, 0.99), percentile(s, 0.999));
+        }
+        return;
+    }
+    
+    out << "{\n"
+        << "  \"players\": " << opt.players << ",\n"
+        << "  \"games_per_player\": " << opt.games << ",\n"
+        << "  \"max_players\": " << opt.max_players << ",\n"
+        << "  \"mode\": \"" << (opt.create ? "create" : "find") << "\",\n"
+        << "  \"seconds\": " << seconds << ",\n"
+        << "  \"requests\": " << total << ",\n"
+        << "  \"errors\": " << errors << ",\n"
+        << "  \"throughput\": " << total / seconds << ",\n"
+        << "  \"latency_us\": {";
+    
+    const char* sep = "\n";
+    for (const auto& entry : all) {
+        const std::vector<double>& s = entry.second;
+        out << sep << "    \"" << msg_type_name(entry.first) << "\": {\"count\": " << s.size()
+            << ", \"p50\": " << percentile(s, 0.5) << ", \"p99\": " << percentile(s, 0.99)
+            << ", \"p999\": " << percentile(s, 0.999) << "}";
+        sep = ",\n";
+    }
+    out << "\n  }\n}" << std::endl;
+}
+
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--create") == 0) {
+            opt.create = true;
+        } else if (strcmp(argv[i], "--dict") == 0 && i + 1 < argc) {
+            opt.dict = argv[++i];
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            opt.json = argv[++i];
+        } else if (positional == 0) {
+            opt.players = std::strtoul(argv[i], nullptr, 10);
+            positional++;
+        } else if (positional == 1) {
+            opt.games = std::strtoul(argv[i], nullptr, 10);
+            positional++;
+        } else {
+            opt.max_players = std::atoi(argv[i]);
+        }
+    }
+    if (opt.max_players < 1 || opt.max_players > MAX_PLAYERS || opt.players % opt.max_players != 0) {
+        std::cerr << "players must be a multiple of max_players (1-" << MAX_PLAYERS << ")" << std::endl;
+        return 1;
+    }
+    
+    Dictionary::shared().load(opt.dict);
+    
+    SharedMemory shm(false);
+    SharedMemoryRoot* root = shm.root();
+    if (opt.players > root->max_clients) {
+        std::cerr << "server only has room for " << root->max_clients << " clients" << std::endl;
+        return 1;
+    }
+    
+    std::vector<std::unique_ptr<Player>> players;
+    for (size_t i = 0; i < opt.players; i++) {
+        players.push_back(std::make_unique<Player>(root, i));
+    }
+    
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < opt.players; i++) {
+        threads.emplace_back([&, i] {
+            Player& p = *players[i];
+            if (!p.register_player()) return;
+            
+            for (size_t round = 0; round < opt.games; round++) {
+                if (!p.enter_game(opt, i / opt.max_players, round)) break;
+                p.play();
+            }
+            
+            p.quit();
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    Samples all;
+    size_t errors = 0;
+    for (auto& p : players) {
+        for (auto& entry : p->samples) {
+            all[entry.first].insert(all[entry.first].end(), entry.second.begin(), entry.second.end());
+        }
+        errors += p->errors;
+    }
+    
+    report(opt, all, errors, seconds, std::cout, false);
+    if (opt.json) {
+        std::ofstream out(opt.json);
+        report(opt, all, errors, seconds, out, true);
+    }
+    
+    return errors ? 2 : 0;
+}
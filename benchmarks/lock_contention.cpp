@@ -0,0 +1,173 @@
+#include "../include/SharedTypes.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+// Compares the old single root mutex against per-client and per-game locks.
+// Each worker thread delivers responses into its own ClientSlot while one
+// thread keeps scanning the game table the way handle_list_games does.
+// Threads are pinned round-robin to the available CPUs. The split locks can
+// only pay off when deliveries really run in parallel: with fewer CPUs than
+// threads they cost a little (a scan takes one lock per game instead of one).
+//
+//   bench_lock_contention [threads] [millis]   (threads defaults to CPUs - 1)
+
+namespace {
+
+// CPUs this process may run on. Pinning needs the Linux affinity calls;
+// elsewhere every online CPU counts and threads are left unpinned.
+std::vector<int> usable_cpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int i = 0; i < CPU_SETSIZE; i++) {
+            if (CPU_ISSET(i, &set)) cpus.push_back(i);
+        }
+    }
+#else
+    for (long i = 0, n = sysconf(_SC_NPROCESSORS_ONLN); i < n; i++) {
+        cpus.push_back(static_cast<int>(i));
+    }
+#endif
+    if (cpus.empty()) cpus.push_back(0);
+    return cpus;
+}
+
+void pin(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+struct Counters {
+    std::atomic<uint64_t> deliveries{0};
+    std::atomic<uint64_t> scans{0};
+};
+
+void deliver(ClientSlot* slot, pthread_mutex_t* lock) {
+    pthread_mutex_lock(lock);
+    
+    uint32_t tail = slot->resp_tail.load(std::memory_order_relaxed);
+    Response& r = slot->responses[tail & (RESP_RING_SIZE - 1)];
+    r.seq = tail;
+    r.status = ST_OK;
+    r.body.guess.attempt = 1;
+    r.body.guess.bulls = 2;
+    r.body.guess.cows = 1;
+    slot->resp_tail.store(tail + 1, std::memory_order_release);
+    slot->resp_head.store(tail + 1, std::memory_order_release);
+    
+    pthread_mutex_unlock(lock);
+    notify(slot->ready);
+}
+
+struct Tables {
+    std::unique_ptr<ClientSlot[]> clients;
+    std::unique_ptr<GameData[]> games;
+    size_t client_count;
+    size_t game_count;
+};
+
+int scan(Tables* root, pthread_mutex_t* global) {
+    int players = 0;
+    
+    if (global) pthread_mutex_lock(global);
+    for (size_t i = 0; i < root->game_count; i++) {
+        GameData* g = &root->games[i];
+        if (!global) pthread_mutex_lock(&g->mutex);
+        if (g->used) players += g->player_count;
+        if (!global) pthread_mutex_unlock(&g->mutex);
+    }
+    if (global) pthread_mutex_unlock(global);
+    
+    return players;
+}
+
+double run(Tables* root, pthread_mutex_t* global, size_t threads, const std::vector<int>& cpus, int millis) {
+    Counters counters;
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> pool;
+    
+    for (size_t t = 0; t < threads; t++) {
+        pool.emplace_back([&, t] {
+            pin(cpus[t % cpus.size()]);
+            ClientSlot* slot = &root->clients[t % root->client_count];
+            pthread_mutex_t* lock = global ? global : &slot->mutex;
+            uint64_t n = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                deliver(slot, lock);
+                n++;
+            }
+            counters.deliveries += n;
+        });
+    }
+    
+    pool.emplace_back([&] {
+        pin(cpus[threads % cpus.size()]);
+        uint64_t n = 0;
+        volatile int sink = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            sink += scan(root, global);
+            n++;
+        }
+        counters.scans += n;
+    });
+    
+    std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+    stop = true;
+    for (auto& th : pool) th.join();
+    
+    double seconds = millis / 1000.0;
+    std::cout << (global ? "global-mutex" : "fine-grained")
+              << "  deliveries/s: " << static_cast<uint64_t>(counters.deliveries / seconds)
+              << "  scans/s: " << static_cast<uint64_t>(counters.scans / seconds) << std::endl;
+    
+    return (counters.deliveries + counters.scans) / seconds;
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> cpus = usable_cpus();
+    size_t threads = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : std::max<size_t>(1, cpus.size() - 1);
+    int millis = argc > 2 ? std::atoi(argv[2]) : 1000;
+    
+    auto root = std::make_unique<Tables>();
+    root->client_count = DEFAULT_MAX_CLIENTS;
+    root->game_count = DEFAULT_MAX_GAMES;
+    root->clients.reset(new ClientSlot[root->client_count]());
+    root->games.reset(new GameData[root->game_count]());
+    pthread_mutex_t global;
+    pthread_mutex_init(&global, nullptr);
+    
+    for (size_t i = 0; i < root->client_count; i++) {
+        pthread_mutex_init(&root->clients[i].mutex, nullptr);
+    }
+    for (size_t i = 0; i < root->game_count; i++) {
+        pthread_mutex_init(&root->games[i].mutex, nullptr);
+        root->games[i].used = i % 2 == 0;
+        root->games[i].player_count = 2;
+    }
+    
+    std::cout << "cpus: " << cpus.size() << ", threads: " << threads << " + 1 scanner, duration: " << millis << " ms"
+              << std::endl;
+    double coarse = run(root.get(), &global, threads, cpus, millis);
+    double fine = run(root.get(), nullptr, threads, cpus, millis);
+    std::cout << "speedup: " << fine / coarse << "x" << std::endl;
+    
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include "../include/SharedMemory.hpp"
+#include "../include/RequestRing.hpp"
+#include "../include/ClientIndex.hpp"
+#include "../include/Dictionary.hpp"
+#include "../include/GameReader.hpp"
+#include "../server/Game.hpp"
+#include "../server/CandidateSet.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Micro-benchmarks for the per-request hot paths. Runs without a server on a
+// private segment. Prints ns/op per benchmark; --json writes the same numbers
+// as a flat object that bench_compare reads.
+//
+//   bench_micro [scale] [--dict path] [--json path]
+
+namespace {
+
+constexpr const char* BENCH_SHM_NAME = "/bulls_cows_bench";
+constexpr int REPEATS = 5;
+
+const char* const WORDS[] = {
+    "apple", "beach", "chair", "dance", "earth", "flame", "grace", "house",
+    "image", "juice", "knife", "lemon", "music", "night", "ocean", "pearl"
+};
+constexpr size_t WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+
+volatile uint64_t sink;
+
+// Best of REPEATS runs of `iters` calls, in ns per call.
+template <typename Fn>
+double measure(size_t iters, Fn fn) {
+    double best = 0;
+    for (int r = 0; r < REPEATS; r++) {
+        uint64_t acc = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iters; i++) {
+            acc += fn(i);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iters;
+        sink = acc;
+        if (r == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+}
+
+int main(int argc, char** argv) {
+    size_t scale = 1;
+    const char* json = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json = argv[++i];
+        } else if (strcmp(argv[i], "--dict") == 0 && i + 1 < argc) {
+            Dictionary::shared().load(argv[++i]);
+        } else {
+            scale = std::max<size_t>(1, std::strtoul(argv[i], nullptr, 10));
+        }
+    }
+    
+    ShmConfig config;
+    config.max_clients = 256;
+    config.max_games = 1;
+    config.queue_size = 64;
+    SharedMemory shm(true, config, BENCH_SHM_NAME);
+    SharedMemoryRoot* root = shm.root();
+    
+    std::vector<std::pair<const char*, double>> results;
+    
+    results.emplace_back("bulls_and_cows", measure(1000000 * scale, [&](size_t i) {
+        Score s = Game::calculate_bulls_and_cows(WORDS[i % WORD_COUNT], WORDS[(i / WORD_COUNT) % WORD_COUNT]);
+        return s.bulls + s.cows;
+    }));
+    
+    // One guess against a block of candidate secrets, per secret.
+    std::vector<PackedWord> candidates(4096);
+    for (size_t i = 0; i < candidates.size(); i++) {
+        candidates[i] = pack_word(WORDS[(i * 7) % WORD_COUNT]);
+    }
+    std::vector<Score> scores(candidates.size());
+    double batch = measure(200 * scale, [&](size_t i) {
+        GuessScorer(pack_word(WORDS[i % WORD_COUNT])).score_batch(candidates.data(), candidates.size(), scores.data());
+        return scores[i % scores.size()].bulls;
+    });
+    results.emplace_back("score_batch", batch / candidates.size());
+    
+    // First narrowing of a player's candidate set, per dictionary word.
+    CandidateSet set;
+    size_t dictionary_size = Dictionary::shared().size();
+    double narrow = measure(std::max<size_t>(1, 1000000 * scale / dictionary_size), [&](size_t i) {
+        set.reset();
+        PackedWord guess = Dictionary::shared().data()[i % dictionary_size];
+        set.narrow(guess, Score{1, 1});
+        return set.size();
+    });
+    results.emplace_back("narrow_candidates", narrow / dictionary_size);
+    
+    results.emplace_back("is_valid_guess", measure(1000000 * scale, [&](size_t i) {
+        return Game::is_valid_guess(WORDS[i % WORD_COUNT]);
+    }));
+    
+    results.emplace_back("generate_secret", measure(20000 * scale, [&](size_t) {
+        return Game::generate_secret();
+    }));
+    
+    // Server::find_client is a ClientIndex lookup on the segment.
+    ClientIndex index(root);
+    ClientSlot* clients = root->clients();
+    for (size_t i = 0; i < root->max_clients; i++) {
+        clients[i].used = true;
+        snprintf(clients[i].login, LOGIN_MAX, "player%zu", i);
+        index.insert(clients[i].login, static_cast<int>(i));
+    }
+    std::vector<std::string> logins;
+    for (size_t i = 0; i < root->max_clients; i++) {
+        logins.push_back("player" + std::to_string((i * 7919) % root->max_clients));
+    }
+    results.emplace_back("find_client", measure(1000000 * scale, [&](size_t i) {
+        return reinterpret_cast<uintptr_t>(index.find(logins[i % logins.size()].c_str()));
+    }));
+    
+    // One producer and the consumer on the same thread: reserve, fill,
+    // commit, then front and pop.
+    RequestRing ring(root);
+    results.emplace_back("queue_roundtrip", measure(1000000 * scale, [&](size_t i) {
+        uint64_t ticket;
+        Message* m = ring.reserve(ticket);
+        m->seq = static_cast<uint32_t>(i);
+        m->type = MSG_GUESS;
+        strcpy(m->body.guess.word, "apple");
+        ring.commit(ticket);
+        
+        Message* front = ring.front();
+        uint32_t seq = front->seq;
+        ring.pop();
+        return seq;
+    }));
+    
+    GameData* gdata = &root->games()[0];
+    gdata->used = true;
+    strcpy(gdata->game_name, "bench");
+    gdata->max_players = MAX_PLAYERS;
+    gdata->player_count = MAX_PLAYERS;
+    gdata->state = GAME_ACTIVE;
+    gdata->winner_index = -1;
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        snprintf(gdata->players[i], LOGIN_MAX, "player%d", i);
+        gdata->attempts[i] = i;
+    }
+    Game game(gdata);
+    GameSnapshot snapshot;
+    results.emplace_back("get_status", measure(1000000 * scale, [&](size_t) {
+        game.get_status(snapshot);
+        return snapshot.player_count;
+    }));
+    int game_id = make_game_id(gdata->generation.load(), 0);
+    results.emplace_back("read_game", measure(1000000 * scale, [&](size_t) {
+        read_game(root, game_id, snapshot);
+        return snapshot.player_count;
+    }));
+    
+    for (const auto& r : results) {
+        printf("%-16s %10.1f ns/op\n", r.first, r.second);
+    }
+    
+    if (json) {
+        std::ofstream out(json);
+        out << "{";
+        const char* sep = "\n";
+        for (const auto& r : results) {
+            out << sep << "  \"" << r.first << "\": " << r.second;
+            sep = ",\n";
+        }
+        out << "\n}" << std::endl;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include "../include/WaitWord.hpp"
+#include <pthread.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Round-trip latency between two threads handing a token back and forth,
+// first through a process-shared mutex/condvar pair (the old wakeup path),
+// then through WaitWords.
+
+namespace {
+
+struct CondChannel {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint64_t value;
+};
+
+struct WordChannel {
+    WaitWord ready;
+    std::atomic<uint64_t> value;
+};
+
+void init(CondChannel& c) {
+    pthread_mutexattr_t mattr;
+    pthread_mutexattr_init(&mattr);
+    pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_SHARED);
+    pthread_condattr_t cattr;
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setpshared(&cattr, PTHREAD_PROCESS_SHARED);
+    
+    pthread_mutex_init(&c.mutex, &mattr);
+    pthread_cond_init(&c.cond, &cattr);
+    c.value = 0;
+    
+    pthread_mutexattr_destroy(&mattr);
+    pthread_condattr_destroy(&cattr);
+}
+
+void send(CondChannel& c, uint64_t v) {
+    pthread_mutex_lock(&c.mutex);
+    c.value = v;
+    pthread_cond_signal(&c.cond);
+    pthread_mutex_unlock(&c.mutex);
+}
+
+void receive(CondChannel& c, uint64_t v) {
+    pthread_mutex_lock(&c.mutex);
+    while (c.value != v) {
+        pthread_cond_wait(&c.cond, &c.mutex);
+    }
+    pthread_mutex_unlock(&c.mutex);
+}
+
+void send(WordChannel& c, uint64_t v) {
+    c.value.store(v, std::memory_order_release);
+    notify(c.ready);
+}
+
+void receive(WordChannel& c, uint64_t v) {
+    while (true) {
+        uint32_t key = wait_prepare(c.ready);
+        if (c.value.load(std::memory_order_acquire) == v) return;
+        wait_until(c.ready, key);
+    }
+}
+
+template <typename Channel>
+void run(const char* name, Channel& ping, Channel& pong, size_t rounds) {
+    std::thread echo([&] {
+        for (uint64_t i = 1; i <= rounds; i++) {
+            receive(ping, i);
+            send(pong, i);
+        }
+    });
+    
+    std::vector<double> samples;
+    samples.reserve(rounds);
+    
+    for (uint64_t i = 1; i <= rounds; i++) {
+        auto start = std::chrono::steady_clock::now();
+        send(ping, i);
+        receive(pong, i);
+        samples.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+    }
+    echo.join();
+    
+    std::sort(samples.begin(), samples.end());
+    std::cout << name
+              << "  p50: " << samples[samples.size() / 2] << " ns"
+              << "  p99: " << samples[samples.size() * 99 / 100] << " ns" << std::endl;
+}
+
+}
+
+int main(int argc, char** argv) {
+    size_t rounds = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    std::cout << "round trips: " << rounds << std::endl;
+    
+    CondChannel cond_ping, cond_pong;
+    init(cond_ping);
+    init(cond_pong);
+    run("mutex+condvar", cond_ping, cond_pong, rounds);
+    
+    WordChannel word_ping{}, word_pong{};
+    run("wait-word    ", word_ping, word_pong, rounds);
+    
+    return 0;
+}
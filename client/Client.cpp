@@ -1,84 +1,354 @@
 #include "Client.hpp"
+#include "../include/ClientIndex.hpp"
+#include "../include/GameReader.hpp"
+#include "../include/WaitWord.hpp"
 #include <iostream>
 #include <sstream>
 #include <cstring>
+#include <cstdlib>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
-#include <sys/time.h>
 
-Client::Client() : shm(false), root(shm.root()), current_game_id(-1), in_game(false) {
+Client::Client()
+    : shm(false), root(shm.root()), ring(root), slot(nullptr), slot_index(-1), token(0),
+      next_seq(1), current_game_id(-1), in_game(false), stopping(false), input_closed(false) {
+    if (pipe(wake_pipe) == -1) {
+        throw std::runtime_error("Failed to create wake pipe");
+    }
+    for (int fd : wake_pipe) {
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+    }
     std::cout << "=== Bulls and Cows Client ===" << std::endl;
 }
 
 Client::~Client() {
+    stopping.store(true);
+    if (watcher.joinable()) {
+        notify(slot->ready);
+        watcher.join();
+    }
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
 }
 
-ClientSlot* Client::my_slot() {
-    for (size_t i = 0; i < MAX_CLIENTS; i++) {
-        if (root->clients[i].used && strcmp(root->clients[i].login, login.c_str()) == 0) {
-            return &root->clients[i];
+// The main thread drains the ring itself; this thread only reports that
+// there is something to drain. An extra byte costs one empty drain.
+void Client::watch_loop() {
+    while (!stopping.load()) {
+        uint32_t key = wait_prepare(slot->ready);
+        slot->heartbeat_ns.store(monotonic_ns(), std::memory_order_relaxed);
+        
+        if (slot->resp_head.load(std::memory_order_acquire) != slot->resp_tail.load(std::memory_order_acquire)) {
+            char byte = 1;
+            if (write(wake_pipe[1], &byte, 1) == -1 && errno != EAGAIN) break;
         }
+        
+        struct timespec deadline = monotonic_deadline(CLIENT_HEARTBEAT_MS);
+        wait_until(slot->ready, key, &deadline);
     }
-    return nullptr;
 }
 
-bool Client::enqueue_message(const Message& m) {
-    pthread_mutex_lock(&root->mutex);
+// Reads one line from stdin without shutting out the server: events pushed
+// while the user is typing are printed as they arrive, followed by the
+// prompt again. stdin is read directly so poll() sees all unread input.
+bool Client::read_line(std::string& line, const char* prompt) {
+    show_events();
+    std::cout << prompt << std::flush;
     
-    size_t next = (root->q_tail + 1) % QUEUE_SIZE;
-    if (next == root->q_head) {
-        pthread_mutex_unlock(&root->mutex);
-        std::cerr << "Queue is full" << std::endl;
-        return false;
+    while (true) {
+        size_t end = input.find('\n');
+        if (end != std::string::npos || (input_closed && !input.empty())) {
+            line = input.substr(0, end);
+            input.erase(0, end == std::string::npos ? end : end + 1);
+            return true;
+        }
+        if (input_closed) return false;
+        
+        struct pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {slot ? wake_pipe[0] : -1, POLLIN, 0}};
+        if (poll(fds, 2, -1) == -1) {
+            if (errno != EINTR) input_closed = true;
+            continue;
+        }
+        
+        if (fds[1].revents & POLLIN) {
+            char bytes[64];
+            while (read(wake_pipe[0], bytes, sizeof(bytes)) > 0) {
+            }
+            drain_responses();
+            if (!events.empty()) {
+                std::cout << std::endl;
+                show_events();
+                std::cout << prompt << input << std::flush;
+            }
+        }
+        
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            char buf[4096];
+            ssize_t n = read(STDIN_FILENO, buf, sizeof(buf));
+            if (n > 0) {
+                input.append(buf, n);
+            } else if (n == 0 || errno != EINTR) {
+                input_closed = true;
+            }
+        }
     }
+}
+
+// Events only concern the game we are in; any left over from one we have
+// since left are dropped.
+void Client::show_events() {
+    for (const GameEvent& e : events) {
+        if (!in_game || (current_game_id != -1 && e.game_id != current_game_id)) continue;
+        
+        switch (e.kind) {
+            case EVENT_PLAYER_JOINED:
+                std::cout << "* " << e.login << " joined (" << e.player_count << "/" << e.max_players << " players)";
+                break;
+            case EVENT_PLAYER_LEFT:
+                std::cout << "* " << e.login << " left the game";
+                break;
+            case EVENT_GAME_STARTED:
+                std::cout << "* The game has started! Make your guess.";
+                break;
+            case EVENT_GAME_WON:
+                std::cout << "* 🏆 " << e.login << " won the game in " << e.attempts << " attempts!";
+                break;
+            case EVENT_GAME_ENDED:
+                std::cout << "* Time is up: the game ended without a winner";
+                break;
+            case EVENT_TIMED_OUT:
+                std::cout << "* You were removed from the game for not guessing";
+                in_game = false;
+                current_game_id = -1;
+                break;
+            case EVENT_GAME_CLOSED:
+                std::cout << "* The game was closed";
+                in_game = false;
+                current_game_id = -1;
+                break;
+        }
+        std::cout << std::endl;
+    }
+    events.clear();
+}
+
+// Used once, while registering: the server publishes the new slot in the
+// client index and then bumps root->registrations.
+ClientSlot* Client::wait_for_slot(int timeout_ms) {
+    ClientIndex index(root);
+    struct timespec deadline = monotonic_deadline(timeout_ms);
     
-    root->queue[root->q_tail] = m;
-    root->queue[root->q_tail].used = true;
-    root->q_tail = next;
+    while (true) {
+        uint32_t key = wait_prepare(root->registrations);
+        ClientSlot* found = index.find(login.c_str());
+        if (found) return found;
+        
+        if (!wait_until(root->registrations, key, &deadline)) return nullptr;
+    }
+}
+
+uint32_t Client::send_message(MsgType type, const RequestBody* body) {
+    uint64_t ticket;
+    Message* m = ring.reserve(ticket);
+    if (!m) {
+        std::cerr << "Queue is full" << std::endl;
+        return 0;
+    }
     
-    pthread_cond_signal(&root->server_cond);
-    pthread_mutex_unlock(&root->mutex);
+    uint32_t seq = next_seq++;
+    if (next_seq == 0) next_seq = 1;
+    
+    strncpy(m->from, login.c_str(), LOGIN_MAX - 1);
+    m->from[LOGIN_MAX - 1] = '\0';
+    strcpy(m->to, "server");
+    m->pid = getpid();
+    m->seq = seq;
+    m->slot = slot_index;
+    m->token = token;
+    m->type = type;
+    if (body) {
+        m->body = *body;
+    }
     
-    return true;
+    ring.commit(ticket);
+    return seq;
 }
 
-bool Client::wait_for_response(std::string &out, int timeout_ms) {
-    struct timespec ts;
-    struct timeval tv;
-    gettimeofday(&tv, nullptr);
-    ts.tv_sec = tv.tv_sec + timeout_ms / 1000;
-    ts.tv_nsec = tv.tv_usec * 1000 + (timeout_ms % 1000) * 1000000;
-    
-    ClientSlot* slot = nullptr;
-    for (int i = 0; i < 100 && !slot; i++) {
-        usleep(10000);
-        slot = my_slot();
+void Client::drain_responses() {
+    uint32_t head = slot->resp_head.load(std::memory_order_relaxed);
+    uint32_t tail = slot->resp_tail.load(std::memory_order_acquire);
+    
+    while (head != tail) {
+        const Response& r = slot->responses[head & (RESP_RING_SIZE - 1)];
+        if (token == 0) {
+            // The reply to MSG_REGISTER hands us the session for all later requests.
+            slot_index = r.slot;
+            token = r.token;
+        }
+        if (r.type == MSG_EVENT) {
+            events.push_back(r.body.event);
+        } else {
+            pending[r.seq] = r;
+        }
+        head++;
     }
     
+    slot->resp_head.store(head, std::memory_order_release);
+}
+
+bool Client::take_pending(uint32_t seq, Response &out) {
+    auto it = pending.find(seq);
+    if (it == pending.end()) return false;
+    
+    out = it->second;
+    pending.erase(it);
+    return true;
+}
+
+bool Client::wait_for_response(uint32_t seq, Response &out, int timeout_ms) {
+    if (seq == 0) return false;
+    if (take_pending(seq, out)) return true;
     if (!slot) return false;
     
-    pthread_mutex_lock(&root->mutex);
+    struct timespec deadline = monotonic_deadline(timeout_ms);
     
-    while (!slot->has_response) {
-        int ret = pthread_cond_timedwait(&slot->cond, &root->mutex, &ts);
-        if (ret != 0) {
-            pthread_mutex_unlock(&root->mutex);
+    while (true) {
+        if (token != 0 && slot->generation.load(std::memory_order_acquire) != token) {
+            std::cerr << "Session expired" << std::endl;
             return false;
         }
+        
+        uint32_t key = wait_prepare(slot->ready);
+        drain_responses();
+        if (take_pending(seq, out)) return true;
+        
+        if (!wait_until(slot->ready, key, &deadline)) return false;
+    }
+}
+
+static const char* status_text(uint8_t status) {
+    switch (status) {
+        case ST_UNKNOWN_TYPE: return "ERROR: Unknown message type";
+        case ST_SERVER_FULL: return "ERROR: Server is full";
+        case ST_NAME_REQUIRED: return "ERROR: Game name required";
+        case ST_INVALID_MAX_PLAYERS: return "ERROR: Invalid max_players";
+        case ST_GAMES_FULL: return "ERROR: Cannot create game (server full)";
+        case ST_GAME_NOT_FOUND: return "ERROR: Game not found";
+        case ST_CANNOT_JOIN: return "ERROR: Cannot join game (full or already joined)";
+        case ST_NO_GAMES: return "ERROR: No available games found";
+        case ST_NOT_IN_GAME: return "ERROR: You are not in a game";
+        case ST_GAME_NOT_ACTIVE: return "ERROR: Game is not active";
+        case ST_NOT_IN_THIS_GAME: return "ERROR: You are not in this game";
+        case ST_ALREADY_FINISHED: return "INFO: You already finished!";
+        case ST_INVALID_GUESS: return "ERROR: Invalid guess. Must be a known 5-letter word in lowercase";
+        default: return "ERROR: Unknown status";
+    }
+}
+
+static const char* state_text(GameState state) {
+    switch (state) {
+        case GAME_WAITING: return "WAITING";
+        case GAME_ACTIVE: return "ACTIVE";
+        default: return "FINISHED";
+    }
+}
+
+static void print_guess(const GuessResult& g) {
+    std::cout << "Attempt #" << g.attempt << " - Bulls: " << (int)g.bulls << ", Cows: " << (int)g.cows;
+    if (g.flags & GUESS_WINNER) {
+        std::cout << "\n🎉 CONGRATULATIONS! You are the WINNER! You guessed the word: \"" << g.secret
+                  << "\" in " << g.attempt << " attempts!";
+    }
+    std::cout << std::endl;
+}
+
+static void print_status(const GameSnapshot& g) {
+    std::cout << "Game: " << g.game_name << "\nState: ";
+    switch (g.state) {
+        case GAME_WAITING: std::cout << "Waiting for players"; break;
+        case GAME_ACTIVE: std::cout << "Active"; break;
+        case GAME_FINISHED: std::cout << "Finished"; break;
+    }
+    std::cout << "\nPlayers (" << g.player_count << "/" << g.max_players << "):\n";
+    
+    for (int i = 0; i < g.player_count; i++) {
+        std::cout << "  - " << g.players[i].login << " (attempts: " << g.players[i].attempts;
+        if (i == g.winner_index) {
+            std::cout << ", 🏆 WINNER! ✓";
+        } else if (g.players[i].finished) {
+            std::cout << ", finished";
+        }
+        std::cout << ")\n";
     }
     
-    out = std::string(slot->response);
-    slot->has_response = false;
-    
-    pthread_mutex_unlock(&root->mutex);
+    if (g.state == GAME_FINISHED && g.winner_index >= 0) {
+        std::cout << "\n🏆 Winner: " << g.players[g.winner_index].login
+                  << " guessed the word in " << g.players[g.winner_index].attempts << " attempts!";
+    }
+    std::cout << std::endl;
+}
+
+void Client::print_response(const Response &r) {
+    if (r.status != ST_OK) {
+        std::cout << status_text(r.status) << std::endl;
+        return;
+    }
     
-    return true;
+    switch (r.type) {
+        case MSG_REGISTER:
+            std::cout << "OK: Registered successfully" << std::endl;
+            break;
+        case MSG_LIST_GAMES:
+            for (int i = 0; i < r.body.list.count; i++) {
+                const GameSummary& g = r.body.list.games[i];
+                std::cout << "  - " << g.game_name
+                          << " (" << g.player_count << "/" << g.max_players << " players)"
+                          << " [" << state_text(g.state) << "]" << std::endl;
+            }
+            break;
+        case MSG_CREATE_GAME:
+            std::cout << "OK: Game created: " << r.body.game.game_name
+                      << " (ID: " << r.body.game.game_id << ")" << std::endl;
+            break;
+        case MSG_JOIN_GAME:
+        case MSG_FIND_GAME:
+            std::cout << "OK: Joined game: " << r.body.game.game_name << std::endl;
+            break;
+        case MSG_GUESS:
+            print_guess(r.body.guess);
+            break;
+        case MSG_HINT:
+            std::cout << "Words still possible: " << r.body.hint.remaining;
+            if (r.body.hint.remaining > 0) {
+                std::cout << "\nSuggested guess: " << r.body.hint.suggestion;
+            }
+            std::cout << std::endl;
+            break;
+        case MSG_GAME_STATUS:
+            print_status(r.body.status);
+            break;
+        case MSG_LEAVE_GAME:
+            std::cout << "OK: Left game" << std::endl;
+            break;
+    }
+}
+
+// The start is pushed by the server; it may already be queued when the
+// join filled the game.
+void Client::enter_game(const Response &r) {
+    in_game = true;
+    current_game_id = r.body.game.game_id;
+    
+    for (const GameEvent& e : events) {
+        if (e.game_id == current_game_id && e.kind == EVENT_GAME_STARTED) return;
+    }
+    std::cout << "Waiting for game to start..." << std::endl;
 }
 
 void Client::run() {
-    std::cout << "Enter your name: ";
-    std::getline(std::cin, login);
-    
-    if (login.empty()) {
+    if (!read_line(login, "Enter your name: ") || login.empty()) {
         std::cout << "Invalid name" << std::endl;
         return;
     }
@@ -101,12 +371,11 @@ void Client::show_main_menu() {
     std::cout << "3. Join game" << std::endl;
     std::cout << "4. Find any game" << std::endl;
     std::cout << "5. Exit" << std::endl;
-    std::cout << "Choice: ";
     
     std::string choice;
-    if (!std::getline(std::cin, choice)) {
+    if (!read_line(choice, "Choice: ")) {
         std::cout << "\nInput stream closed. Exiting..." << std::endl;
-        exit(0);
+        cmd_quit();
     }
     
     if (choice == "1") {
@@ -118,23 +387,25 @@ void Client::show_main_menu() {
     } else if (choice == "4") {
         cmd_find_game();
     } else if (choice == "5") {
-        exit(0);
+        cmd_quit();
     }
 }
 
 void Client::show_game_menu() {
     std::cout << "\n=== Game Menu ===" << std::endl;
-    std::cout << "1. Make guess (enter 5-letter word)" << std::endl;
+    std::cout << "1. Make guess (or type one or more 5-letter words)" << std::endl;
     std::cout << "2. Game status" << std::endl;
     std::cout << "3. Leave game" << std::endl;
-    std::cout << "Choice: ";
+    std::cout << "4. Hint" << std::endl;
     
     std::string choice;
-    if (!std::getline(std::cin, choice)) {
+    if (!read_line(choice, "Choice: ")) {
         std::cout << "\nInput stream closed. Leaving game..." << std::endl;
         cmd_leave_game();
-        exit(0);
+        cmd_quit();
     }
+    // The server may have taken us out of the game while we were waiting.
+    if (!in_game) return;
     
     if (choice == "1") {
         cmd_guess();
@@ -142,208 +413,232 @@ void Client::show_game_menu() {
         cmd_game_status();
     } else if (choice == "3") {
         cmd_leave_game();
-    } else if (choice.length() == 5 && isalpha(choice[0])) {
-        std::string guess = choice;
-        for (char& c : guess) {
+    } else if (choice == "4") {
+        cmd_hint();
+    } else if (!choice.empty() && isalpha(choice[0])) {
+        send_guesses(choice);
+    }
+}
+
+void Client::send_guesses(const std::string& line) {
+    std::istringstream iss(line);
+    std::vector<std::string> guesses;
+    std::string word;
+    
+    while (iss >> word) {
+        if (word.length() != SECRET_LENGTH) return;
+        for (char& c : word) {
             c = tolower(c);
         }
-        
-        Message m;
-        m.used = true;
-        strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-        strcpy(m.to, "server");
-        m.type = MSG_GUESS;
-        strncpy(m.payload, guess.c_str(), CMD_MAX - 1);
-        
-        enqueue_message(m);
-        
-        std::string response;
-        if (wait_for_response(response)) {
-            std::cout << response << std::endl;
+        guesses.push_back(word);
+    }
+    
+    if (guesses.size() > BATCH_MAX) {
+        std::cout << "At most " << BATCH_MAX << " guesses at once" << std::endl;
+        return;
+    }
+    
+    // The whole run goes out as one MSG_BATCH and comes back as one reply.
+    RequestBody body;
+    body.batch.count = guesses.size();
+    for (size_t i = 0; i < guesses.size(); i++) {
+        strcpy(body.batch.guesses[i].word, guesses[i].c_str());
+    }
+    
+    Response response;
+    if (!wait_for_response(send_message(MSG_BATCH, &body), response)) {
+        std::cout << "Timeout waiting for response" << std::endl;
+        return;
+    }
+    if (response.status != ST_OK) {
+        print_response(response);
+        return;
+    }
+    
+    const BatchResult& batch = response.body.batch;
+    for (int i = 0; i < batch.count; i++) {
+        std::cout << guesses[i] << ": ";
+        if (batch.status[i] == ST_OK) {
+            print_guess(batch.results[i]);
         } else {
-            std::cout << "Timeout waiting for response" << std::endl;
+            std::cout << status_text(batch.status[i]) << std::endl;
         }
     }
 }
 
 void Client::cmd_register() {
-    Message m;
-    m.used = true;
-    strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-    m.from[LOGIN_MAX - 1] = '\0';
-    strcpy(m.to, "server");
-    m.type = MSG_REGISTER;
-    m.payload[0] = '\0';
-    
-    enqueue_message(m);
-    
-    std::string response;
-    if (wait_for_response(response)) {
-        std::cout << response << std::endl;
+    uint32_t seq = send_message(MSG_REGISTER);
+    slot = wait_for_slot(3000);
+    
+    Response response;
+    if (wait_for_response(seq, response)) {
+        print_response(response);
     } else {
         std::cout << "Failed to register" << std::endl;
         exit(1);
     }
+    watcher = std::thread(&Client::watch_loop, this);
+    
+    seq = send_message(MSG_SUBSCRIBE);
+    if (!wait_for_response(seq, response) || response.status != ST_OK) {
+        std::cout << "Failed to subscribe to game events" << std::endl;
+    }
+    
+    // A server recovered from its journal may still have us seated in a game.
+    seq = send_message(MSG_GAME_STATUS);
+    if (wait_for_response(seq, response) && response.status == ST_OK) {
+        std::cout << "Resuming game" << std::endl;
+        in_game = true;
+        print_response(response);
+    }
 }
 
 void Client::cmd_list_games() {
-    Message m;
-    m.used = true;
-    strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-    strcpy(m.to, "server");
-    m.type = MSG_LIST_GAMES;
-    m.payload[0] = '\0';
+    std::cout << "Available games:" << std::endl;
     
-    enqueue_message(m);
+    RequestBody body;
+    body.list.offset = 0;
+    int listed = 0;
     
-    std::string response;
-    if (wait_for_response(response)) {
-        std::cout << response << std::endl;
+    while (body.list.offset != -1) {
+        uint32_t seq = send_message(MSG_LIST_GAMES, &body);
+        
+        Response response;
+        if (!wait_for_response(seq, response) || response.status != ST_OK) {
+            return;
+        }
+        
+        print_response(response);
+        listed += response.body.list.count;
+        body.list.offset = response.body.list.next_offset;
+    }
+    
+    if (listed == 0) {
+        std::cout << "  No games available" << std::endl;
     }
 }
 
 void Client::cmd_create_game() {
-    std::cout << "Enter game name: ";
     std::string game_name;
-    std::getline(std::cin, game_name);
+    read_line(game_name, "Enter game name: ");
     
-    std::cout << "Enter max players (1-10, default 2): ";
     std::string max_str;
-    std::getline(std::cin, max_str);
-    int max_players = max_str.empty() ? 2 : std::stoi(max_str);
-    
-    Message m;
-    m.used = true;
-    strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-    strcpy(m.to, "server");
-    m.type = MSG_CREATE_GAME;
-    
-    std::ostringstream oss;
-    oss << game_name << " " << max_players;
-    strncpy(m.payload, oss.str().c_str(), CMD_MAX - 1);
-    m.payload[CMD_MAX - 1] = '\0';
-    
-    enqueue_message(m);
-    
-    std::string response;
-    if (wait_for_response(response)) {
-        std::cout << response << std::endl;
-        if (response.find("OK") == 0) {
-            in_game = true;
-            
-            std::cout << "Waiting for other players or starting game..." << std::endl;
-            sleep(1);
-            
-            cmd_game_status();
+    read_line(max_str, "Enter max players (1-10, default 2): ");
+    
+    RequestBody body;
+    strncpy(body.create.game_name, game_name.c_str(), LOGIN_MAX - 1);
+    body.create.game_name[LOGIN_MAX - 1] = '\0';
+    body.create.max_players = max_str.empty() ? 2 : atoi(max_str.c_str());
+    uint32_t seq = send_message(MSG_CREATE_GAME, &body);
+    
+    Response response;
+    if (wait_for_response(seq, response)) {
+        print_response(response);
+        if (response.status == ST_OK) {
+            enter_game(response);
         }
     }
 }
 
 void Client::cmd_join_game() {
-    std::cout << "Enter game name: ";
     std::string game_name;
-    std::getline(std::cin, game_name);
-    
-    Message m;
-    m.used = true;
-    strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-    strcpy(m.to, "server");
-    m.type = MSG_JOIN_GAME;
-    strncpy(m.payload, game_name.c_str(), CMD_MAX - 1);
-    m.payload[CMD_MAX - 1] = '\0';
-    
-    enqueue_message(m);
-    
-    std::string response;
-    if (wait_for_response(response)) {
-        std::cout << response << std::endl;
-        if (response.find("OK") == 0) {
-            in_game = true;
-            
-            std::cout << "Waiting for game to start..." << std::endl;
-            sleep(1);
-            cmd_game_status();
+    read_line(game_name, "Enter game name: ");
+    
+    RequestBody body;
+    strncpy(body.join.game_name, game_name.c_str(), LOGIN_MAX - 1);
+    body.join.game_name[LOGIN_MAX - 1] = '\0';
+    uint32_t seq = send_message(MSG_JOIN_GAME, &body);
+    
+    Response response;
+    if (wait_for_response(seq, response)) {
+        print_response(response);
+        if (response.status == ST_OK) {
+            enter_game(response);
         }
     }
 }
 
 void Client::cmd_find_game() {
-    Message m;
-    m.used = true;
-    strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-    strcpy(m.to, "server");
-    m.type = MSG_FIND_GAME;
-    m.payload[0] = '\0';
-    
-    enqueue_message(m);
-    
-    std::string response;
-    if (wait_for_response(response)) {
-        std::cout << response << std::endl;
-        if (response.find("OK") == 0) {
-            in_game = true;
-            
-            std::cout << "Waiting for game to start..." << std::endl;
-            sleep(1);
-            cmd_game_status();
+    std::string max_str;
+    read_line(max_str, "Enter players per game (1-10, blank for any): ");
+    
+    RequestBody body;
+    body.find.max_players = atoi(max_str.c_str());
+    uint32_t seq = send_message(MSG_FIND_GAME, &body);
+    
+    Response response;
+    if (wait_for_response(seq, response)) {
+        print_response(response);
+        if (response.status == ST_OK) {
+            enter_game(response);
         }
     }
 }
 
 void Client::cmd_guess() {
-    std::cout << "Enter your guess (5-letter word, lowercase): ";
     std::string guess;
-    std::getline(std::cin, guess);
+    read_line(guess, "Enter your guess (5-letter word, lowercase): ");
     
     for (char& c : guess) {
         c = tolower(c);
     }
     
-    Message m;
-    m.used = true;
-    strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-    strcpy(m.to, "server");
-    m.type = MSG_GUESS;
-    strncpy(m.payload, guess.c_str(), CMD_MAX - 1);
-    m.payload[CMD_MAX - 1] = '\0';
+    RequestBody body;
+    strncpy(body.guess.word, guess.c_str(), SECRET_LENGTH);
+    body.guess.word[SECRET_LENGTH] = '\0';
+    if (guess.length() > SECRET_LENGTH) {
+        body.guess.word[0] = '\0';
+    }
+    uint32_t seq = send_message(MSG_GUESS, &body);
     
-    enqueue_message(m);
+    Response response;
+    if (wait_for_response(seq, response)) {
+        print_response(response);
+    }
+}
+
+void Client::cmd_hint() {
+    uint32_t seq = send_message(MSG_HINT);
     
-    std::string response;
-    if (wait_for_response(response)) {
-        std::cout << response << std::endl;
+    Response response;
+    if (wait_for_response(seq, response)) {
+        print_response(response);
     }
 }
 
+// Read straight from the segment when we know our game; the server is only
+// asked if that fails or we are no longer seated there.
 void Client::cmd_game_status() {
-    Message m;
-    m.used = true;
-    strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-    strcpy(m.to, "server");
-    m.type = MSG_GAME_STATUS;
-    m.payload[0] = '\0';
+    GameSnapshot status;
+    if (current_game_id != -1 && read_game(root, current_game_id, status)) {
+        for (int i = 0; i < status.player_count; i++) {
+            if (login == status.players[i].login) {
+                print_status(status);
+                return;
+            }
+        }
+    }
     
-    enqueue_message(m);
+    uint32_t seq = send_message(MSG_GAME_STATUS);
     
-    std::string response;
-    if (wait_for_response(response)) {
-        std::cout << response << std::endl;
+    Response response;
+    if (wait_for_response(seq, response)) {
+        print_response(response);
     }
 }
 
 void Client::cmd_leave_game() {
-    Message m;
-    m.used = true;
-    strncpy(m.from, login.c_str(), LOGIN_MAX - 1);
-    strcpy(m.to, "server");
-    m.type = MSG_LEAVE_GAME;
-    m.payload[0] = '\0';
-    
-    enqueue_message(m);
-    
-    std::string response;
-    if (wait_for_response(response)) {
-        std::cout << response << std::endl;
+    uint32_t seq = send_message(MSG_LEAVE_GAME);
+    
+    Response response;
+    if (wait_for_response(seq, response)) {
+        print_response(response);
         in_game = false;
+        current_game_id = -1;
     }
 }
+
+void Client::cmd_quit() {
+    send_message(MSG_QUIT);
+    exit(0);
+}
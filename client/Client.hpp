@@ -1,25 +1,55 @@
 #pragma once
 #include "../include/SharedTypes.hpp"
 #include "../include/SharedMemory.hpp"
+#include "../include/RequestRing.hpp"
+#include <atomic>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 class Client {
 public:
     Client();
     ~Client();
-
+    
     void run();
 
 private:
     SharedMemory shm;
     SharedMemoryRoot* root;
+    RequestRing ring;
     std::string login;
+    ClientSlot* slot;
+    int32_t slot_index;
+    uint32_t token;
+    uint32_t next_seq;
+    std::unordered_map<uint32_t, Response> pending;
+    std::vector<GameEvent> events;
     int current_game_id;
     bool in_game;
-
-    bool enqueue_message(const Message& m);
-    bool wait_for_response(std::string &out, int timeout_ms = 3000);
-    ClientSlot* my_slot();
+    
+    // Refreshes slot->heartbeat_ns and writes a byte to wake_pipe whenever
+    // something lands in the slot, so read_line() can poll for server
+    // pushes and stdin together.
+    std::thread watcher;
+    std::atomic<bool> stopping;
+    int wake_pipe[2];
+    void watch_loop();
+    
+    std::string input;
+    bool input_closed;
+    bool read_line(std::string& line, const char* prompt = "");
+    void show_events();
+    
+    uint32_t send_message(MsgType type, const RequestBody* body = nullptr);
+    bool wait_for_response(uint32_t seq, Response &out, int timeout_ms = 3000);
+    void drain_responses();
+    bool take_pending(uint32_t seq, Response &out);
+    
+    void print_response(const Response &r);
+    void enter_game(const Response &r);
+    ClientSlot* wait_for_slot(int timeout_ms);
     
     void show_main_menu();
     void show_game_menu();
@@ -30,6 +60,9 @@ private:
     void cmd_join_game();
     void cmd_find_game();
     void cmd_guess();
+    void send_guesses(const std::string& line);
     void cmd_game_status();
     void cmd_leave_game();
+    void cmd_hint();
+    void cmd_quit();
 };
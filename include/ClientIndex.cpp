@@ -0,0 +1,109 @@
+#include "ClientIndex.hpp"
+
+uint32_t ClientIndex::hash(const char* login) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < LOGIN_MAX - 1 && login[i]; i++) {
+        h ^= static_cast<uint8_t>(login[i]);
+        h *= 16777619u;
+    }
+    
+    if (h == INDEX_EMPTY) {
+        h++;
+    }
+    return h;
+}
+
+ClientSlot* ClientIndex::find(const char* login) const {
+    uint32_t h = hash(login);
+    
+    while (true) {
+        uint32_t before = moves->load(std::memory_order_acquire);
+        ClientSlot* slot = (before & 1) ? nullptr : probe(login, h);
+        if (slot) return slot;
+        
+        // A miss only counts if no erase moved entries meanwhile.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!(before & 1) && moves->load(std::memory_order_relaxed) == before) return nullptr;
+        cpu_relax();
+    }
+}
+
+ClientSlot* ClientIndex::probe(const char* login, uint32_t h) const {
+    for (size_t n = 0, i = h & (capacity - 1); n < capacity; n++, i = (i + 1) & (capacity - 1)) {
+        uint32_t stored = entries[i].hash.load(std::memory_order_acquire);
+        if (stored == INDEX_EMPTY) {
+            return nullptr;
+        }
+        if (stored != h) {
+            continue;
+        }
+        
+        ClientSlot* slot = &slots[entries[i].slot.load(std::memory_order_relaxed)];
+        if (slot->used.load(std::memory_order_relaxed) && strncmp(slot->login, login, LOGIN_MAX - 1) == 0) {
+            return slot;
+        }
+    }
+    
+    return nullptr;
+}
+
+bool ClientIndex::insert(const char* login, int slot) {
+    uint32_t h = hash(login);
+    
+    for (size_t n = 0, i = h & (capacity - 1); n < capacity; n++, i = (i + 1) & (capacity - 1)) {
+        uint32_t stored = entries[i].hash.load(std::memory_order_relaxed);
+        if (stored == INDEX_EMPTY) {
+            entries[i].slot.store(slot, std::memory_order_relaxed);
+            entries[i].hash.store(h, std::memory_order_release);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+void ClientIndex::erase(const char* login) {
+    uint32_t h = hash(login);
+    
+    for (size_t n = 0, i = h & (capacity - 1); n < capacity; n++, i = (i + 1) & (capacity - 1)) {
+        uint32_t stored = entries[i].hash.load(std::memory_order_relaxed);
+        if (stored == INDEX_EMPTY) {
+            return;
+        }
+        if (stored != h) {
+            continue;
+        }
+        
+        ClientSlot* slot = &slots[entries[i].slot.load(std::memory_order_relaxed)];
+        if (strncmp(slot->login, login, LOGIN_MAX - 1) == 0) {
+            shift_back(i);
+            return;
+        }
+    }
+}
+
+// Backward-shift deletion: walks the rest of the probe run after the hole
+// at i and moves back every entry whose home position does not lie between
+// the hole and where it sits, so no probe ever has to cross the hole. A
+// moved entry is written at its new place before its old one is reused, so
+// readers may see it twice but miss it only while `moves` is odd.
+void ClientIndex::shift_back(size_t i) {
+    size_t mask = capacity - 1;
+    moves->fetch_add(1, std::memory_order_acq_rel);
+    
+    for (size_t j = (i + 1) & mask; j != i; j = (j + 1) & mask) {
+        uint32_t stored = entries[j].hash.load(std::memory_order_relaxed);
+        if (stored == INDEX_EMPTY) break;
+        
+        size_t home = stored & mask;
+        bool stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+        if (stays) continue;
+        
+        entries[i].slot.store(entries[j].slot.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        entries[i].hash.store(stored, std::memory_order_release);
+        i = j;
+    }
+    
+    entries[i].hash.store(INDEX_EMPTY, std::memory_order_release);
+    moves->fetch_add(1, std::memory_order_release);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "SharedTypes.hpp"
+
+// Open-addressing login -> ClientSlot index over a table that lives in shared
+// memory. The server is the only writer; clients and server workers look up
+// without locks and confirm the hit against ClientSlot::login. Erasing
+// shifts later entries of the probe run back instead of leaving tombstones,
+// so a miss always stops at the end of a short run; `moves` is odd while
+// that happens and readers that missed during a shift look again.
+class ClientIndex {
+public:
+    ClientIndex(ClientIndexEntry* entries, size_t capacity, ClientSlot* slots, std::atomic<uint32_t>* moves)
+        : entries(entries), capacity(capacity), slots(slots), moves(moves) {}
+    explicit ClientIndex(SharedMemoryRoot* root)
+        : ClientIndex(root->client_index(), root->client_index_size, root->clients(), &root->client_index_moves) {}
+    
+    static uint32_t hash(const char* login);
+    
+    ClientSlot* find(const char* login) const;
+    bool insert(const char* login, int slot);
+    void erase(const char* login);
+
+private:
+    ClientIndexEntry* entries;
+    size_t capacity;
+    ClientSlot* slots;
+    std::atomic<uint32_t>* moves;
+    
+    ClientSlot* probe(const char* login, uint32_t h) const;
+    void shift_back(size_t i);
+};
@@ -0,0 +1,129 @@
+#include "Dictionary.hpp"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char* const BUILTIN_WORDS[] = {
+    "apple", "beach", "chair", "dance", "earth",
+    "flame", "grace", "house", "image", "juice",
+    "knife", "lemon", "music", "night", "ocean",
+    "pearl", "queen", "river", "stone", "table",
+    "unity", "voice", "water", "youth", "zebra",
+    "bread", "cloud", "dream", "field", "globe",
+    "heart", "light", "magic", "paint", "smile",
+    "storm", "tiger", "tower", "whale", "world"
+};
+
+// xorshift64*, seeded once per thread.
+static uint64_t next_random() {
+    thread_local uint64_t state = [] {
+        uint64_t seed = std::random_device()();
+        seed ^= static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) << 1;
+        return seed ? seed : 0x9e3779b97f4a7c15ull;
+    }();
+    
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1dull;
+}
+
+Dictionary& Dictionary::shared() {
+    static Dictionary dictionary;
+    return dictionary;
+}
+
+Dictionary::Dictionary() {
+    std::vector<PackedWord> list;
+    for (const char* w : BUILTIN_WORDS) {
+        list.push_back(pack_word(w));
+    }
+    build(std::move(list));
+}
+
+bool Dictionary::load(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) return false;
+    
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    
+    size_t length = st.st_size;
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return false;
+    
+    const char* text = static_cast<const char*>(mapped);
+    const char* end = text + length;
+    std::vector<PackedWord> list;
+    
+    while (text < end) {
+        const char* line = text;
+        while (text < end && *text != '\n') text++;
+        
+        const char* stop = text;
+        if (stop > line && stop[-1] == '\r') stop--;
+        
+        bool valid = stop - line == SECRET_LENGTH;
+        for (const char* c = line; valid && c < stop; c++) {
+            valid = *c >= 'a' && *c <= 'z';
+        }
+        if (valid) {
+            PackedWord w = 0;
+            for (int i = 0; i < SECRET_LENGTH; i++) {
+                w |= PackedWord(static_cast<uint8_t>(line[i])) << (8 * i);
+            }
+            list.push_back(w);
+        }
+        text++;
+    }
+    
+    munmap(mapped, length);
+    
+    if (list.empty()) return false;
+    build(std::move(list));
+    return true;
+}
+
+void Dictionary::build(std::vector<PackedWord> list) {
+    std::sort(list.begin(), list.end());
+    list.erase(std::unique(list.begin(), list.end()), list.end());
+    words = std::move(list);
+    
+    size_t capacity = 16;
+    while (capacity < 2 * words.size()) capacity <<= 1;
+    table.assign(capacity, 0);
+    
+    for (PackedWord w : words) {
+        table[slot(w)] = w;
+    }
+}
+
+// First slot holding `word` or empty, probing linearly from a
+// multiply-shift hash.
+size_t Dictionary::slot(PackedWord word) const {
+    size_t mask = table.size() - 1;
+    size_t i = (word * 0x9e3779b97f4a7c15ull) >> 32 & mask;
+    
+    while (table[i] != 0 && table[i] != word) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+bool Dictionary::contains(PackedWord word) const {
+    return word != 0 && table[slot(word)] == word;
+}
+
+PackedWord Dictionary::random_word() const {
+    // Multiply-high maps the 64-bit draw onto [0, size) without a division.
+    size_t index = static_cast<size_t>((static_cast<unsigned __int128>(next_random()) * words.size()) >> 64);
+    return words[index];
+}
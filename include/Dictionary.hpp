@@ -0,0 +1,34 @@
+#pragma once
+#include "Scoring.hpp"
+#include <vector>
+
+constexpr const char* DEFAULT_DICTIONARY_PATH = "/usr/share/dict/words";
+
+// The set of words that may be secrets or guesses. Holds the built-in list
+// until load() reads a word list file (one word per line; anything that is
+// not SECRET_LENGTH lowercase letters is skipped). load() runs before the
+// server's threads start and the dictionary is read-only afterwards, so it
+// is shared without locking.
+class Dictionary {
+public:
+    static Dictionary& shared();
+    
+    bool load(const char* path);
+    
+    bool contains(PackedWord word) const;
+    PackedWord random_word() const;
+    
+    size_t size() const { return words.size(); }
+    const PackedWord* data() const { return words.data(); }
+
+private:
+    Dictionary();
+    
+    // Sorted and unique. table is an open-addressing set over the same
+    // words (0 = empty) sized to at most half full.
+    std::vector<PackedWord> words;
+    std::vector<PackedWord> table;
+    
+    void build(std::vector<PackedWord> list);
+    size_t slot(PackedWord word) const;
+};
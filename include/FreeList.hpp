@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Intrusive lock-free free list (Treiber stack) over a shared-memory array.
+// Items link through a `next_free` index; the head packs (index + 1) in the
+// low half and an ABA tag in the high half, so 0 means empty.
+struct FreeList {
+    std::atomic<uint64_t> head;
+};
+
+template <typename T>
+void free_list_init(FreeList& list, T* items, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        items[i].next_free.store(i + 1 < count ? static_cast<int32_t>(i + 1) : -1, std::memory_order_relaxed);
+    }
+    list.head.store(count ? 1 : 0, std::memory_order_release);
+}
+
+template <typename T>
+int free_list_pop(FreeList& list, T* items) {
+    uint64_t head = list.head.load(std::memory_order_acquire);
+    
+    while (true) {
+        uint32_t top = static_cast<uint32_t>(head);
+        if (top == 0) return -1;
+        
+        int index = static_cast<int>(top - 1);
+        int32_t next = items[index].next_free.load(std::memory_order_relaxed);
+        uint64_t tag = (head >> 32) + 1;
+        uint64_t desired = (tag << 32) | static_cast<uint32_t>(next + 1);
+        
+        if (list.head.compare_exchange_weak(head, desired, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            return index;
+        }
+    }
+}
+
+template <typename T>
+void free_list_push(FreeList& list, T* items, int index) {
+    uint64_t head = list.head.load(std::memory_order_relaxed);
+    
+    while (true) {
+        items[index].next_free.store(static_cast<int32_t>(static_cast<uint32_t>(head)) - 1, std::memory_order_relaxed);
+        uint64_t tag = (head >> 32) + 1;
+        uint64_t desired = (tag << 32) | static_cast<uint32_t>(index + 1);
+        
+        if (list.head.compare_exchange_weak(head, desired, std::memory_order_release, std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
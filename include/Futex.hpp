@@ -0,0 +1,48 @@
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+// Process-shared futex wrappers. The word must live in shared memory, so the
+// non-private operations are used. futex_wait_until takes an absolute
+// CLOCK_MONOTONIC deadline, or nullptr to wait without one.
+//
+// Hosts without futexes poll instead: a wait sleeps for a millisecond and the
+// caller re-checks the word; past the deadline it fails with ETIMEDOUT as
+// the syscall would, and wakes are no-ops.
+inline int futex_wait_until(std::atomic<uint32_t>* word, uint32_t expected, const struct timespec* deadline) {
+#ifdef __linux__
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_BITSET, expected, deadline, nullptr,
+                   FUTEX_BITSET_MATCH_ANY);
+#else
+    if (deadline) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > deadline->tv_sec || (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec)) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+    }
+    if (word->load(std::memory_order_acquire) == expected) {
+        usleep(1000);
+    }
+    return 0;
+#endif
+}
+
+inline int futex_wake(std::atomic<uint32_t>* word, int count) {
+#ifdef __linux__
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, count, nullptr, nullptr, 0);
+#else
+    (void)word;
+    (void)count;
+    return 0;
+#endif
+}
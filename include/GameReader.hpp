@@ -0,0 +1,55 @@
+#pragma once
+#include "SharedTypes.hpp"
+#include "WaitWord.hpp"
+#include <algorithm>
+#include <cstring>
+
+// Lock-free reads of a game straight from the segment, for clients that
+// want its status without a round trip through the server. Server threads
+// change a GameData only between game_write_lock() and game_write_unlock(),
+// which keep GameData::seq odd for the duration; a reader copies the
+// fields and keeps the copy only if seq was even and unchanged around it.
+
+constexpr int GAME_READ_TRIES = 64;
+
+// Copies the fields MSG_GAME_STATUS reports. A racing reader may see a
+// torn player_count, so the loop bound is clamped before it is validated.
+inline void fill_game_snapshot(const GameData& g, GameSnapshot& out) {
+    memcpy(out.game_name, g.game_name, LOGIN_MAX);
+    out.game_name[LOGIN_MAX - 1] = '\0';
+    out.state = g.state;
+    out.player_count = std::min(std::max(g.player_count, 0), MAX_PLAYERS);
+    out.max_players = g.max_players;
+    out.winner_index = g.winner_index;
+    
+    for (int i = 0; i < out.player_count; i++) {
+        memcpy(out.players[i].login, g.players[i], LOGIN_MAX);
+        out.players[i].login[LOGIN_MAX - 1] = '\0';
+        out.players[i].attempts = g.attempts[i];
+        out.players[i].finished = g.finished[i];
+    }
+}
+
+// Fills out with a consistent copy of game_id. Returns false if the id no
+// longer names a live game or writers kept the game busy for
+// GAME_READ_TRIES attempts; either way the caller should ask the server.
+inline bool read_game(SharedMemoryRoot* root, int game_id, GameSnapshot& out) {
+    if (game_id < 0 || static_cast<uint32_t>(game_index(game_id)) >= root->max_games) return false;
+    const GameData& g = root->games()[game_index(game_id)];
+    
+    for (int tries = 0; tries < GAME_READ_TRIES; tries++) {
+        uint32_t before = g.seq.load(std::memory_order_acquire);
+        if (before & 1) {
+            cpu_relax();
+            continue;
+        }
+        
+        bool current = g.used &&
+                       (g.generation.load(std::memory_order_relaxed) & GAME_GENERATION_MASK) == game_generation(game_id);
+        fill_game_snapshot(g, out);
+        
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (g.seq.load(std::memory_order_relaxed) == before) return current;
+    }
+    return false;
+}
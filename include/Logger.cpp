@@ -0,0 +1,295 @@
+#include "Logger.hpp"
+#include "Signals.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <strings.h>
+#include <unistd.h>
+
+namespace {
+
+struct EventInfo {
+    LogLevel level;
+    uint32_t rate_limit;      // records per second, 0 = unlimited
+    LogArgs args;
+    const char* format;       // %s is the string, %lld the number, in that order
+};
+
+const EventInfo EVENTS[EV_COUNT] = {
+    {LOG_DEBUG, 1000, ARGS_TEXT_NUM, "[MSG] From: %s, Type: %lld"},
+    {LOG_WARN, 10, ARGS_TEXT, "Dropping message with stale session from %s"},
+    {LOG_WARN, 10, ARGS_TEXT, "Response ring full, dropping reply to %s"},
+    {LOG_INFO, 0, ARGS_TEXT, "Client registered: %s"},
+    {LOG_INFO, 0, ARGS_TEXT, "Client quit: %s"},
+    {LOG_INFO, 0, ARGS_TEXT_NUM, "Game created: %s (ID: %lld)"},
+    {LOG_INFO, 0, ARGS_TEXT, "Game %s started!"},
+    {LOG_INFO, 0, ARGS_TEXT_NUM, "Player %s left game %lld"},
+    {LOG_WARN, 0, ARGS_NUM, "Log ring full, %lld records dropped"},
+    {LOG_INFO, 0, ARGS_NUM, "Snapshot written at journal lsn %lld"},
+    {LOG_ERROR, 0, ARGS_NONE, "Failed to write snapshot"},
+    {LOG_INFO, 0, ARGS_TEXT, "Reaped dead client %s"},
+    {LOG_INFO, 0, ARGS_TEXT_NUM, "Player %s timed out in game %lld"},
+    {LOG_INFO, 0, ARGS_TEXT_NUM, "Game %s timed out (ID: %lld)"},
+    {LOG_INFO, 0, ARGS_TEXT_NUM, "Recycled finished game %s (ID: %lld)"},
+    {LOG_ERROR, 1, ARGS_NONE, "Journal full, dropping records until the next snapshot"},
+    {LOG_WARN, 0, ARGS_NUM, "Released %lld request cells left unpublished by dead clients"},
+};
+
+const char* const LEVEL_NAMES[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+uint64_t realtime_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+void write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data += n;
+        size -= n;
+    }
+}
+
+}
+
+LogLevel log_event_level(uint16_t event) {
+    return event < EV_COUNT ? EVENTS[event].level : LOG_ERROR;
+}
+
+LogArgs log_event_args(uint16_t event) {
+    return event < EV_COUNT ? EVENTS[event].args : ARGS_NONE;
+}
+
+bool parse_log_level(const char* text, LogLevel& out) {
+    for (int i = LOG_DEBUG; i <= LOG_ERROR; i++) {
+        if (strcasecmp(text, LEVEL_NAMES[i]) == 0) {
+            out = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void format_log_record(const LogRecord& r, std::string& out) {
+    char line[256];
+    time_t seconds = r.time_ns / 1000000000ull;
+    struct tm tm;
+    localtime_r(&seconds, &tm);
+    
+    size_t n = strftime(line, sizeof(line), "%Y-%m-%d %H:%M:%S", &tm);
+    n += snprintf(line + n, sizeof(line) - n, ".%06llu %-5s ",
+                  static_cast<unsigned long long>(r.time_ns % 1000000000ull / 1000),
+                  LEVEL_NAMES[std::min(static_cast<int>(r.level), static_cast<int>(LOG_ERROR))]);
+    
+    char a[LOGIN_MAX];
+    memcpy(a, r.a, LOGIN_MAX);
+    a[LOGIN_MAX - 1] = '\0';
+    
+    size_t room = sizeof(line) - n;
+    long long num = r.num;
+    if (r.event >= EV_COUNT) {
+        n += snprintf(line + n, room, "unknown event %u", r.event);
+    } else {
+        const char* format = EVENTS[r.event].format;
+        switch (EVENTS[r.event].args) {
+            case ARGS_NONE: n += snprintf(line + n, room, "%s", format); break;
+            case ARGS_TEXT: n += snprintf(line + n, room, format, a); break;
+            case ARGS_NUM: n += snprintf(line + n, room, format, num); break;
+            case ARGS_TEXT_NUM: n += snprintf(line + n, room, format, a, num); break;
+        }
+    }
+    if (r.suppressed && n < sizeof(line)) {
+        snprintf(line + n, sizeof(line) - n, " (%u similar suppressed)", r.suppressed);
+    }
+    
+    out += line;
+}
+
+Logger& Logger::shared() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+    : cells(new Cell[RING_SIZE]()), tail(0), head(0), ready{}, dropped(0), running(false), stopping(false),
+      level(LOG_INFO), fd(STDOUT_FILENO), binary(false) {
+    for (size_t i = 0; i < RING_SIZE; i++) {
+        cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+    for (Limiter& l : limiters) {
+        l.window.store(0, std::memory_order_relaxed);
+        l.used.store(0, std::memory_order_relaxed);
+        l.suppressed.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool Logger::start(LogLevel min_level, const char* path) {
+    if (running.load()) return true;
+    
+    level = min_level;
+    binary = path != nullptr;
+    fd = STDOUT_FILENO;
+    
+    if (binary) {
+        fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd == -1) return false;
+        
+        // A new or empty file gets the header; an existing log is appended to.
+        if (lseek(fd, 0, SEEK_END) == 0) {
+            LogFileHeader header = {};
+            memcpy(header.magic, LOG_FILE_MAGIC, sizeof(header.magic));
+            header.record_size = sizeof(LogRecord);
+            write_all(fd, reinterpret_cast<const char*>(&header), sizeof(header));
+        }
+    }
+    
+    stopping.store(false);
+    running.store(true);
+    writer = std::thread(&Logger::loop, this);
+    return true;
+}
+
+void Logger::stop() {
+    if (!running.exchange(false)) return;
+    
+    stopping.store(true);
+    notify(ready);
+    writer.join();
+    
+    if (binary) {
+        close(fd);
+    }
+}
+
+// The first record of each one-second window resets the count; records
+// over the limit only bump the suppressed count carried by the next one.
+bool Logger::admit(LogEvent event, uint32_t& suppressed) {
+    suppressed = 0;
+    uint32_t limit = EVENTS[event].rate_limit;
+    if (limit == 0) return true;
+    
+    Limiter& l = limiters[event];
+    uint64_t now = realtime_ns() / 1000000000ull;
+    uint64_t window = l.window.load(std::memory_order_relaxed);
+    if (window != now && l.window.compare_exchange_strong(window, now, std::memory_order_relaxed)) {
+        l.used.store(0, std::memory_order_relaxed);
+    }
+    
+    if (l.used.fetch_add(1, std::memory_order_relaxed) >= limit) {
+        l.suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    suppressed = l.suppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+}
+
+void Logger::append(LogEvent event, LogArgs args, const char* a, int64_t num) {
+    // Every call site must match its event's shape in EVENTS.
+    assert(args == EVENTS[event].args);
+    (void)args;
+    if (!running.load(std::memory_order_relaxed) || EVENTS[event].level < level) return;
+    
+    uint32_t suppressed;
+    if (!admit(event, suppressed)) return;
+    
+    uint64_t pos = tail.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+        cell = &cells[pos & (RING_SIZE - 1)];
+        uint64_t seq = cell->seq.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+        
+        if (diff == 0) {
+            if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = tail.load(std::memory_order_relaxed);
+        }
+    }
+    
+    LogRecord& r = cell->record;
+    r.time_ns = realtime_ns();
+    r.num = num;
+    r.suppressed = suppressed;
+    r.event = event;
+    r.level = EVENTS[event].level;
+    if (a) {
+        strncpy(r.a, a, LOGIN_MAX - 1);
+        r.a[LOGIN_MAX - 1] = '\0';
+    } else {
+        r.a[0] = '\0';
+    }
+    
+    cell->seq.store(pos + 1, std::memory_order_release);
+    notify(ready, 1);
+}
+
+// Takes every published record off the ring into the output buffers.
+size_t Logger::drain(std::string& text, std::string& raw) {
+    size_t taken = 0;
+    
+    uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+    if (lost) {
+        LogRecord r = {};
+        r.time_ns = realtime_ns();
+        r.num = static_cast<int64_t>(lost);
+        r.event = EV_DROPPED;
+        r.level = LOG_WARN;
+        if (binary) {
+            raw.append(reinterpret_cast<const char*>(&r), sizeof(r));
+        } else {
+            format_log_record(r, text);
+            text += '\n';
+        }
+        taken++;
+    }
+    
+    while (true) {
+        Cell& cell = cells[head & (RING_SIZE - 1)];
+        if (cell.seq.load(std::memory_order_acquire) != head + 1) break;
+        
+        if (binary) {
+            raw.append(reinterpret_cast<const char*>(&cell.record), sizeof(LogRecord));
+        } else {
+            format_log_record(cell.record, text);
+            text += '\n';
+        }
+        
+        cell.seq.store(head + RING_SIZE, std::memory_order_release);
+        head++;
+        taken++;
+    }
+    
+    return taken;
+}
+
+void Logger::loop() {
+    block_server_signals();
+    std::string text, raw;
+    
+    while (true) {
+        uint32_t key = wait_prepare(ready);
+        
+        if (drain(text, raw)) {
+            const std::string& out = binary ? raw : text;
+            write_all(fd, out.data(), out.size());
+            text.clear();
+            raw.clear();
+            continue;
+        }
+        if (stopping.load()) break;
+        
+        struct timespec deadline = monotonic_deadline(100);
+        wait_until(ready, key, &deadline);
+    }
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include "SharedTypes.hpp"
+#include <memory>
+#include <string>
+#include <thread>
+
+// Asynchronous event log. Callers on the request path only copy a
+// fixed-size LogRecord into a lock-free ring; a background thread formats
+// records and writes them out in batches, either as text or, when a log
+// file is given, as raw records for bc-logdecode. A full ring drops records
+// rather than blocking the caller.
+
+enum LogLevel : uint8_t {
+    LOG_DEBUG = 0,
+    LOG_INFO = 1,
+    LOG_WARN = 2,
+    LOG_ERROR = 3
+};
+
+// Each event has one fixed shape: a string (login or game name), a number,
+// both or neither. Events are logged through the log_event() overload for
+// their shape; the formatter passes the format exactly those arguments.
+enum LogArgs : uint8_t {
+    ARGS_NONE,
+    ARGS_TEXT,
+    ARGS_NUM,
+    ARGS_TEXT_NUM
+};
+
+enum LogEvent : uint16_t {
+    EV_MESSAGE = 0,           // a: login, num: MsgType
+    EV_STALE_SESSION,         // a: login
+    EV_RESPONSE_RING_FULL,    // a: login
+    EV_CLIENT_REGISTERED,     // a: login
+    EV_CLIENT_QUIT,           // a: login
+    EV_GAME_CREATED,          // a: game name, num: game id
+    EV_GAME_STARTED,          // a: game name
+    EV_PLAYER_LEFT,           // a: login, num: game id
+    EV_DROPPED,               // num: records lost to a full ring
+    EV_SNAPSHOT,              // num: last journal lsn included
+    EV_SNAPSHOT_FAILED,       // none
+    EV_CLIENT_REAPED,         // a: login
+    EV_PLAYER_TIMED_OUT,      // a: login, num: game id
+    EV_GAME_TIMED_OUT,        // a: game name, num: game id
+    EV_GAME_RECYCLED,         // a: game name, num: game id
+    EV_JOURNAL_FULL,          // none
+    EV_CELLS_RECLAIMED,       // num: request cells published as MSG_NOP
+    EV_COUNT
+};
+
+// suppressed counts earlier records of the same event dropped by its rate
+// limit since the last one written.
+struct LogRecord {
+    uint64_t time_ns;         // CLOCK_REALTIME
+    int64_t num;
+    uint32_t suppressed;
+    uint16_t event;
+    uint8_t level;
+    char a[LOGIN_MAX];
+};
+
+// Binary log files start with this header, followed by LogRecords.
+constexpr char LOG_FILE_MAGIC[8] = {'B', 'C', 'L', 'O', 'G', '0', '0', '1'};
+
+struct LogFileHeader {
+    char magic[8];
+    uint32_t record_size;
+    uint32_t reserved;
+};
+
+LogLevel log_event_level(uint16_t event);
+LogArgs log_event_args(uint16_t event);
+bool parse_log_level(const char* text, LogLevel& out);
+
+// Appends one line, without the trailing newline.
+void format_log_record(const LogRecord& r, std::string& out);
+
+class Logger {
+public:
+    static Logger& shared();
+    
+    // Starts the writer thread. With a path, records are appended to that
+    // file in binary form; otherwise they are written to stdout as text.
+    bool start(LogLevel level, const char* path = nullptr);
+    // Writes out everything queued so far and stops the writer thread.
+    void stop();
+    
+    void log(LogEvent event) { append(event, ARGS_NONE, nullptr, 0); }
+    void log(LogEvent event, const char* a) { append(event, ARGS_TEXT, a, 0); }
+    void log(LogEvent event, int64_t num) { append(event, ARGS_NUM, nullptr, num); }
+    void log(LogEvent event, const char* a, int64_t num) { append(event, ARGS_TEXT_NUM, a, num); }
+
+private:
+    struct Cell {
+        std::atomic<uint64_t> seq;
+        LogRecord record;
+    };
+    
+    // Per-event rate limit: at most limit records per one-second window.
+    struct Limiter {
+        std::atomic<uint64_t> window;
+        std::atomic<uint32_t> used;
+        std::atomic<uint32_t> suppressed;
+    };
+    
+    static constexpr size_t RING_SIZE = 4096;
+    
+    Logger();
+    
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) uint64_t head;
+    WaitWord ready;
+    std::atomic<uint64_t> dropped;
+    Limiter limiters[EV_COUNT];
+    
+    std::atomic<bool> running;
+    std::atomic<bool> stopping;
+    LogLevel level;
+    int fd;
+    bool binary;
+    std::thread writer;
+    
+    void append(LogEvent event, LogArgs args, const char* a, int64_t num);
+    bool admit(LogEvent event, uint32_t& suppressed);
+    void loop();
+    size_t drain(std::string& text, std::string& raw);
+};
+
+inline void log_event(LogEvent event) {
+    Logger::shared().log(event);
+}
+
+inline void log_event(LogEvent event, const char* a) {
+    Logger::shared().log(event, a);
+}
+
+inline void log_event(LogEvent event, int64_t num) {
+    Logger::shared().log(event, num);
+}
+
+inline void log_event(LogEvent event, const char* a, int64_t num) {
+    Logger::shared().log(event, a, num);
+}
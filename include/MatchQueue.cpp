@@ -0,0 +1,81 @@
+#include "MatchQueue.hpp"
+
+void MatchQueue::init() {
+    pthread_mutexattr_t mattr;
+    shm_mutexattr_init(&mattr);
+    pthread_mutex_init(&lists->mutex, &mattr);
+    pthread_mutexattr_destroy(&mattr);
+    
+    for (int i = 0; i <= MAX_PLAYERS; i++) {
+        lists->head[i] = -1;
+        lists->tail[i] = -1;
+    }
+}
+
+void MatchQueue::update(GameData* games, int index) {
+    GameData* g = &games[index];
+    bool waiting = g->used && g->state == GAME_WAITING && g->player_count < g->max_players;
+    
+    shm_lock(&lists->mutex);
+    if (waiting && g->wait_bucket == -1) {
+        link(games, index);
+    } else if (!waiting && g->wait_bucket != -1) {
+        unlink(games, index);
+    }
+    pthread_mutex_unlock(&lists->mutex);
+}
+
+int MatchQueue::pop(GameData* games, int max_players) {
+    size_t first = max_players > 0 ? max_players : 1;
+    size_t last = max_players > 0 ? max_players : MAX_PLAYERS;
+    if (last > static_cast<size_t>(MAX_PLAYERS)) return -1;
+    
+    int index = -1;
+    shm_lock(&lists->mutex);
+    for (size_t b = first; b <= last && index == -1; b++) {
+        index = lists->head[b];
+    }
+    if (index != -1) {
+        unlink(games, index);
+    }
+    pthread_mutex_unlock(&lists->mutex);
+    
+    return index;
+}
+
+void MatchQueue::link(GameData* games, int index) {
+    GameData* g = &games[index];
+    int bucket = g->max_players;
+    
+    g->wait_bucket = bucket;
+    g->wait_prev = lists->tail[bucket];
+    g->wait_next = -1;
+    
+    if (lists->tail[bucket] != -1) {
+        games[lists->tail[bucket]].wait_next = index;
+    } else {
+        lists->head[bucket] = index;
+    }
+    lists->tail[bucket] = index;
+}
+
+void MatchQueue::unlink(GameData* games, int index) {
+    GameData* g = &games[index];
+    int bucket = g->wait_bucket;
+    
+    if (g->wait_prev != -1) {
+        games[g->wait_prev].wait_next = g->wait_next;
+    } else {
+        lists->head[bucket] = g->wait_next;
+    }
+    
+    if (g->wait_next != -1) {
+        games[g->wait_next].wait_prev = g->wait_prev;
+    } else {
+        lists->tail[bucket] = g->wait_prev;
+    }
+    
+    g->wait_bucket = -1;
+    g->wait_prev = -1;
+    g->wait_next = -1;
+}
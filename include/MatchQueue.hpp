@@ -0,0 +1,25 @@
+#pragma once
+#include "SharedTypes.hpp"
+
+// Waiting games with free seats, kept in intrusive FIFO lists bucketed by
+// max_players. Only the server touches it.
+class MatchQueue {
+public:
+    explicit MatchQueue(WaitingLists* lists) : lists(lists) {}
+
+    void init();
+
+    // Re-evaluates whether game `index` belongs in its bucket and links or
+    // unlinks it. The caller holds that game's GameData::mutex.
+    void update(GameData* games, int index);
+
+    // Unlinks and returns the oldest waiting game with `max_players` seats
+    // (0 = any size), or -1. The caller then locks the game and re-checks it.
+    int pop(GameData* games, int max_players);
+
+private:
+    WaitingLists* lists;
+
+    void link(GameData* games, int index);
+    void unlink(GameData* games, int index);
+};
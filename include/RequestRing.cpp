@@ -0,0 +1,121 @@
+#include "RequestRing.hpp"
+#include <cerrno>
+#include <csignal>
+
+void RequestRing::init() {
+    for (size_t i = 0; i < size; i++) {
+        cells[i].seq.store(i, std::memory_order_relaxed);
+        cells[i].owner.store(0, std::memory_order_relaxed);
+    }
+    q->head.store(0, std::memory_order_relaxed);
+    q->tail.store(0, std::memory_order_relaxed);
+    q->ready.seq.store(0, std::memory_order_relaxed);
+    q->ready.waiters.store(0, std::memory_order_release);
+}
+
+Message* RequestRing::reserve(uint64_t& ticket) {
+    uint64_t pos = q->tail.load(std::memory_order_relaxed);
+    
+    while (true) {
+        QueueCell& cell = cells[pos & (size - 1)];
+        uint64_t seq = cell.seq.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+        
+        if (diff == 0) {
+            if (q->tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                // The reaper may have given up on the cell before we
+                // claimed it; it publishes the ticket, we take the next.
+                int32_t expected = 0;
+                if (cell.owner.compare_exchange_strong(expected, pid, std::memory_order_acq_rel)) {
+                    ticket = pos;
+                    return &cell.msg;
+                }
+                pos = q->tail.load(std::memory_order_relaxed);
+            }
+        } else if (diff < 0) {
+            return nullptr;
+        } else {
+            pos = q->tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void RequestRing::commit(uint64_t ticket) {
+    QueueCell& cell = cells[ticket & (size - 1)];
+    cell.msg.enqueued_ns = monotonic_ns();
+    cell.seq.store(ticket + 1, std::memory_order_release);
+    notify(q->ready, 1);
+}
+
+Message* RequestRing::front() {
+    uint64_t pos = q->head.load(std::memory_order_relaxed);
+    QueueCell& cell = cells[pos & (size - 1)];
+    
+    if (cell.seq.load(std::memory_order_acquire) != pos + 1) {
+        return nullptr;
+    }
+    return &cell.msg;
+}
+
+void RequestRing::pop() {
+    uint64_t pos = q->head.load(std::memory_order_relaxed);
+    QueueCell& cell = cells[pos & (size - 1)];
+    cell.owner.store(0, std::memory_order_relaxed);
+    cell.seq.store(pos + size, std::memory_order_release);
+    q->head.store(pos + 1, std::memory_order_relaxed);
+}
+
+void RequestRing::wait(int timeout_ms) {
+    uint32_t key = wait_prepare(q->ready);
+    
+    if (front()) return;
+    
+    if (timeout_ms < 0) {
+        wait_until(q->ready, key);
+    } else {
+        struct timespec deadline = monotonic_deadline(timeout_ms);
+        wait_until(q->ready, key, &deadline);
+    }
+}
+
+// A producer SIGKILLed between reserve() and commit() leaves a cell that is
+// never published, and the consumer would wait on it forever. Such a cell
+// is claimed by swapping its owner for CELL_RECLAIMED, then published here.
+// A cell with no owner at all (the producer died right after winning the
+// ticket) is only taken once the previous call saw it stuck as well.
+size_t RequestRing::reclaim() {
+    size_t published = 0;
+    uint64_t stuck = NO_TICKET;
+    uint64_t tail = q->tail.load(std::memory_order_acquire);
+    
+    for (uint64_t pos = q->head.load(std::memory_order_acquire); pos < tail; pos++) {
+        QueueCell& cell = cells[pos & (size - 1)];
+        int32_t owner = cell.owner.load(std::memory_order_acquire);
+        if (cell.seq.load(std::memory_order_acquire) != pos) continue;
+        
+        if (owner == 0) {
+            if (pos != unclaimed) {
+                if (stuck == NO_TICKET) stuck = pos;
+                continue;
+            }
+        } else if (owner == CELL_RECLAIMED || kill(owner, 0) == 0 || errno != ESRCH) {
+            continue;
+        }
+        
+        if (!cell.owner.compare_exchange_strong(owner, CELL_RECLAIMED, std::memory_order_acq_rel)) continue;
+        if (cell.seq.load(std::memory_order_acquire) != pos) {
+            // The cell moved on between the two loads: hand it back.
+            int32_t reclaimed = CELL_RECLAIMED;
+            cell.owner.compare_exchange_strong(reclaimed, owner, std::memory_order_acq_rel);
+            continue;
+        }
+        
+        cell.msg.type = MSG_NOP;
+        cell.msg.slot = -1;
+        commit(pos);
+        published++;
+    }
+    
+    unclaimed = stuck;
+    return published;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "SharedTypes.hpp"
+#include <unistd.h>
+
+class RequestRing {
+public:
+    explicit RequestRing(SharedMemoryRoot* root)
+        : q(&root->queue), cells(root->queue_cells()), size(root->queue_size), pid(getpid()), unclaimed(NO_TICKET) {}
+    
+    void init();
+    
+    // Producer side: reserve a cell, build the message in place, then commit.
+    Message* reserve(uint64_t& ticket);
+    void commit(uint64_t ticket);
+    
+    // Consumer side (single thread): front() returns the oldest published
+    // message or nullptr, pop() hands its cell back to producers.
+    Message* front();
+    void pop();
+    // Sleeps until a message is published, or at most timeout_ms (-1: no limit).
+    void wait(int timeout_ms = -1);
+    
+    // Reaper side: publishes as MSG_NOP every cell whose producer died
+    // between reserve() and commit(). Returns the number of cells published.
+    size_t reclaim();
+
+private:
+    static constexpr uint64_t NO_TICKET = ~0ull;
+    
+    RequestQueue* q;
+    QueueCell* cells;
+    uint64_t size;
+    int32_t pid;
+    // Ticket of a reserved cell that had no owner on the last reclaim().
+    uint64_t unclaimed;
+};
@@ -0,0 +1,108 @@
+#include "Scoring.hpp"
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+constexpr PackedWord LETTER_ONES = 0x0101010101010101ull & WORD_BYTES;
+
+// Number of equal bytes among the word's letters: bytes of x ^ y that are
+// zero keep their high bit clear after the carry trick, and the multiply
+// sums the resulting 0/1 bytes into the top letter byte. Avoids popcount,
+// which is a library call without -mpopcnt.
+static inline int equal_bytes(PackedWord x, PackedWord y) {
+    constexpr PackedWord low7 = 0x7f7f7f7f7f7f7f7full;
+    
+    PackedWord d = x ^ y;
+    PackedWord zero = (~(((d & low7) + low7) | d) >> 7) & LETTER_ONES;
+    return static_cast<int>((zero * LETTER_ONES) >> (8 * (SECRET_LENGTH - 1))) & 0xff;
+}
+
+GuessScorer::GuessScorer(PackedWord guess) : guess(guess & WORD_BYTES), distinct(0) {
+    for (int i = 0; i < SECRET_LENGTH; i++) {
+        uint8_t c = static_cast<uint8_t>(guess >> (8 * i));
+        PackedWord spread = c * LETTER_ONES;
+        
+        int k = 0;
+        while (k < distinct && letters[k] != spread) k++;
+        if (k == distinct) {
+            letters[distinct] = spread;
+            counts[distinct] = 0;
+            distinct++;
+        }
+        counts[k]++;
+    }
+}
+
+Score GuessScorer::score(PackedWord secret) const {
+    secret &= WORD_BYTES;
+    
+    int common = 0;
+    for (int k = 0; k < distinct; k++) {
+        common += std::min<int>(counts[k], equal_bytes(secret, letters[k]));
+    }
+    
+    int bulls = equal_bytes(secret, guess);
+    return Score{static_cast<uint8_t>(bulls), static_cast<uint8_t>(common - bulls)};
+}
+
+#ifdef __SSE2__
+
+// Set bits in each mask of SECRET_LENGTH bits.
+struct MaskBits {
+    uint8_t n[1 << SECRET_LENGTH];
+    
+    constexpr MaskBits() : n() {
+        for (unsigned m = 1; m < (1u << SECRET_LENGTH); m++) {
+            n[m] = n[m >> 1] + (m & 1);
+        }
+    }
+};
+
+static constexpr MaskBits MASK_BITS;
+
+// Two secrets per 128-bit register: byte compares give one mask bit per
+// byte, and the low and high word's letters are counted separately.
+void GuessScorer::score_batch(const PackedWord* secrets, size_t n, Score* out) const {
+    constexpr unsigned letter_mask = (1u << SECRET_LENGTH) - 1;
+    const uint8_t* bits = MASK_BITS.n;
+    
+    __m128i g = _mm_set1_epi64x(static_cast<long long>(guess));
+    __m128i spread[SECRET_LENGTH];
+    for (int k = 0; k < distinct; k++) {
+        spread[k] = _mm_set1_epi64x(static_cast<long long>(letters[k]));
+    }
+    
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(secrets + i));
+        
+        unsigned eq = _mm_movemask_epi8(_mm_cmpeq_epi8(s, g));
+        int bulls0 = bits[eq & letter_mask];
+        int bulls1 = bits[(eq >> 8) & letter_mask];
+        
+        int common0 = 0, common1 = 0;
+        for (int k = 0; k < distinct; k++) {
+            unsigned m = _mm_movemask_epi8(_mm_cmpeq_epi8(s, spread[k]));
+            common0 += std::min<int>(counts[k], bits[m & letter_mask]);
+            common1 += std::min<int>(counts[k], bits[(m >> 8) & letter_mask]);
+        }
+        
+        out[i] = Score{static_cast<uint8_t>(bulls0), static_cast<uint8_t>(common0 - bulls0)};
+        out[i + 1] = Score{static_cast<uint8_t>(bulls1), static_cast<uint8_t>(common1 - bulls1)};
+    }
+    
+    for (; i < n; i++) {
+        out[i] = score(secrets[i]);
+    }
+}
+
+#else
+
+void GuessScorer::score_batch(const PackedWord* secrets, size_t n, Score* out) const {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = score(secrets[i]);
+    }
+}
+
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+#include "SharedTypes.hpp"
+
+// Words are packed one letter per byte, first letter in the low byte, with
+// the upper bytes zero. Packing makes a word one register, so comparing two
+// words position by position is a single XOR.
+using PackedWord = uint64_t;
+
+constexpr PackedWord WORD_BYTES = (PackedWord(1) << (8 * SECRET_LENGTH)) - 1;
+
+// Reads SECRET_LENGTH letters; a shorter string leaves the rest zero.
+inline PackedWord pack_word(const char* word) {
+    PackedWord w = 0;
+    for (int i = 0; i < SECRET_LENGTH && word[i]; i++) {
+        w |= PackedWord(static_cast<uint8_t>(word[i])) << (8 * i);
+    }
+    return w;
+}
+
+inline void unpack_word(PackedWord w, char* out) {
+    for (int i = 0; i < SECRET_LENGTH; i++) {
+        out[i] = static_cast<char>(w >> (8 * i));
+    }
+    out[SECRET_LENGTH] = '\0';
+}
+
+struct Score {
+    uint8_t bulls;
+    uint8_t cows;
+};
+
+// Scores one guess against any number of secrets. The guess is reduced once
+// to its distinct letters and their counts; a secret then costs one compare
+// for bulls and one per distinct letter for the letters in common, each a
+// byte-wise equality count. Repeated letters count at most
+// min(in guess, in secret) times, bulls included.
+class GuessScorer {
+public:
+    explicit GuessScorer(PackedWord guess);
+    
+    Score score(PackedWord secret) const;
+    void score_batch(const PackedWord* secrets, size_t n, Score* out) const;
+
+private:
+    PackedWord guess;
+    int distinct;
+    PackedWord letters[SECRET_LENGTH];    // each distinct letter in every byte
+    uint8_t counts[SECRET_LENGTH];
+};
+
+inline Score score_guess(PackedWord secret, PackedWord guess) {
+    return GuessScorer(guess).score(secret);
+}
@@ -1,66 +1,160 @@
 #include "SharedMemory.hpp"
+#include "RequestRing.hpp"
+#include "MatchQueue.hpp"
+#include <new>
+#include <stdexcept>
 
-SharedMemory::SharedMemory(bool create) : fd(-1), _root(nullptr), owner(create) {
-    if (create) {
-        shm_unlink(SHM_NAME);
+static size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+static uint64_t place(uint64_t& offset, size_t bytes) {
+    uint64_t at = (offset + 63) & ~uint64_t(63);
+    offset = at + bytes;
+    return at;
+}
+
+// Changes whenever one of the shared structures changes size, which a
+// version bump alone can miss between two builds of the same version.
+static uint32_t layout_fingerprint() {
+    const size_t sizes[] = {
+        sizeof(SharedMemoryRoot), sizeof(ClientSlot), sizeof(ClientIndexEntry), sizeof(GameData),
+        sizeof(QueueCell), sizeof(StatsRegion), sizeof(Response)
+    };
+    uint32_t h = 2166136261u;
+    for (size_t s : sizes) {
+        h = (h ^ static_cast<uint32_t>(s)) * 16777619u;
+    }
+    return h;
+}
+
+// Fills in the header's capacities and table offsets; returns the segment size.
+static size_t layout(SharedMemoryRoot& h, const ShmConfig& config) {
+    h.magic = SHM_MAGIC;
+    h.version = SHM_VERSION;
+    h.layout = layout_fingerprint();
+    h.max_clients = config.max_clients;
+    h.max_games = config.max_games;
+    h.queue_size = round_up_pow2(config.queue_size);
+    h.client_index_size = round_up_pow2(2 * config.max_clients);
+    
+    uint64_t offset = sizeof(SharedMemoryRoot);
+    h.clients_offset = place(offset, h.max_clients * sizeof(ClientSlot));
+    h.client_index_offset = place(offset, h.client_index_size * sizeof(ClientIndexEntry));
+    h.games_offset = place(offset, h.max_games * sizeof(GameData));
+    h.queue_offset = place(offset, h.queue_size * sizeof(QueueCell));
+    h.stats_offset = place(offset, sizeof(StatsRegion));
+    h.segment_size = offset;
+    
+    return offset;
+}
+
+SharedMemory::SharedMemory(bool create, const ShmConfig& config, const char* name, bool read_only)
+    : name(name), fd(-1), _root(nullptr), size(0), owner(create), _adopted(false) {
+    SharedMemoryRoot header;
+    
+    // Adopting takes over a live segment as it is; without one the server
+    // starts fresh.
+    bool attach = !create;
+    if (create && config.adopt) {
+        fd = shm_open(name, O_RDWR, 0666);
+        attach = _adopted = fd != -1;
+    }
+    
+    if (!attach) {
+        if (config.max_clients == 0 || config.max_games == 0 || config.queue_size < 2 ||
+            config.max_games > GAME_INDEX_LIMIT) {
+            throw std::runtime_error("Invalid shared memory capacities");
+        }
+        size = layout(header, config);
+        
+        shm_unlink(name);
         
-        fd = shm_open(SHM_NAME, O_CREAT | O_RDWR, 0666);
+        fd = shm_open(name, O_CREAT | O_RDWR, 0666);
         if (fd == -1) {
             throw std::runtime_error("Failed to create shared memory");
         }
         
-        if (ftruncate(fd, sizeof(SharedMemoryRoot)) == -1) {
+        if (ftruncate(fd, size) == -1) {
             close(fd);
-            shm_unlink(SHM_NAME);
+            shm_unlink(name);
             throw std::runtime_error("Failed to set size of shared memory");
         }
     } else {
-        fd = shm_open(SHM_NAME, O_RDWR, 0666);
+        if (fd == -1) {
+            fd = shm_open(name, read_only ? O_RDONLY : O_RDWR, 0666);
+        }
         if (fd == -1) {
             throw std::runtime_error("Failed to open shared memory. Is server running?");
         }
+        
+        struct stat st;
+        if (fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < sizeof(SharedMemoryRoot)) {
+            close(fd);
+            throw std::runtime_error("Shared memory is not initialized");
+        }
+        size = st.st_size;
     }
     
     _root = static_cast<SharedMemoryRoot*>(
-        mmap(nullptr, sizeof(SharedMemoryRoot), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+        mmap(nullptr, size, read_only ? PROT_READ : PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
     );
     
     if (_root == MAP_FAILED) {
         close(fd);
-        if (create) shm_unlink(SHM_NAME);
+        if (!attach) shm_unlink(name);
         throw std::runtime_error("Failed to map shared memory");
     }
     
-    if (create) {
-        memset(_root, 0, sizeof(SharedMemoryRoot));
-        
-        pthread_mutexattr_t mattr;
-        pthread_mutexattr_init(&mattr);
-        pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_SHARED);
-        pthread_mutex_init(&_root->mutex, &mattr);
-        pthread_mutexattr_destroy(&mattr);
-        
-        pthread_condattr_t cattr;
-        pthread_condattr_init(&cattr);
-        pthread_condattr_setpshared(&cattr, PTHREAD_PROCESS_SHARED);
-        pthread_cond_init(&_root->server_cond, &cattr);
-        
-        for (size_t i = 0; i < MAX_CLIENTS; i++) {
-            pthread_cond_init(&_root->clients[i].cond, &cattr);
-            _root->clients[i].current_game_id = -1;
+    if (attach) {
+        if (_root->magic != SHM_MAGIC || _root->version != SHM_VERSION || _root->layout != layout_fingerprint() ||
+            _root->segment_size != size) {
+            munmap(_root, size);
+            _root = nullptr;
+            close(fd);
+            fd = -1;
+            // A segment this build cannot read is not ours to remove.
+            owner = false;
+            throw std::runtime_error("Shared memory layout does not match this build");
         }
-        
-        pthread_condattr_destroy(&cattr);
-        
-        _root->q_head = 0;
-        _root->q_tail = 0;
-        _root->game_count = 0;
+        return;
     }
+    
+    // The header holds atomics, so it is constructed rather than cleared;
+    // the tables behind it start out as zero bytes.
+    new (_root) SharedMemoryRoot();
+    memset(reinterpret_cast<char*>(_root) + sizeof(SharedMemoryRoot), 0, size - sizeof(SharedMemoryRoot));
+    layout(*_root, config);
+    
+    pthread_mutexattr_t mattr;
+    shm_mutexattr_init(&mattr);
+    
+    ClientSlot* clients = _root->clients();
+    for (size_t i = 0; i < _root->max_clients; i++) {
+        pthread_mutex_init(&clients[i].mutex, &mattr);
+        clients[i].current_game_id = -1;
+    }
+    
+    GameData* games = _root->games();
+    for (size_t i = 0; i < _root->max_games; i++) {
+        pthread_mutex_init(&games[i].mutex, &mattr);
+        games[i].wait_bucket = -1;
+    }
+    
+    pthread_mutexattr_destroy(&mattr);
+    
+    free_list_init(_root->free_clients, clients, _root->max_clients);
+    free_list_init(_root->free_games, games, _root->max_games);
+    
+    MatchQueue(&_root->waiting).init();
+    RequestRing(_root).init();
 }
 
 SharedMemory::~SharedMemory() {
     if (_root && _root != MAP_FAILED) {
-        munmap(_root, sizeof(SharedMemoryRoot));
+        munmap(_root, size);
     }
     
     if (fd != -1) {
@@ -68,6 +162,6 @@ SharedMemory::~SharedMemory() {
     }
     
     if (owner) {
-        shm_unlink(SHM_NAME);
+        shm_unlink(name);
     }
 }
@@ -5,16 +5,38 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+// Capacities of a segment created by the server. Clients attach with the
+// defaults and take the real values from the segment header. Benchmarks
+// pass their own segment name so they never touch a running server's;
+// monitoring tools attach read_only. A server with adopt set takes over an
+// existing segment, keeping its capacities, and only creates one if none
+// exists.
+struct ShmConfig {
+    size_t max_clients = DEFAULT_MAX_CLIENTS;
+    size_t max_games = DEFAULT_MAX_GAMES;
+    size_t queue_size = DEFAULT_QUEUE_SIZE;
+    bool adopt = false;
+};
+
 class SharedMemory {
 public:
-    SharedMemory(bool create = false);
+    SharedMemory(bool create = false, const ShmConfig& config = ShmConfig(), const char* name = SHM_NAME,
+                 bool read_only = false);
     ~SharedMemory();
 
     SharedMemoryRoot* root() { return _root; }
     bool is_owner() const { return owner; }
+    bool adopted() const { return _adopted; }
+    
+    // Leaves the segment in place on destruction, for a server handing it
+    // over to its successor.
+    void release() { owner = false; }
 
 private:
+    const char* name;
     int fd;
     SharedMemoryRoot* _root;
+    size_t size;
     bool owner;
+    bool _adopted;
 };
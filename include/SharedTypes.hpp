@@ -1,18 +1,53 @@
 #pragma once
+#include <atomic>
+#include <cerrno>
 #include <cstdint>
 #include <cstring>
 #include <ctime>
 #include <pthread.h>
+#include "FreeList.hpp"
+#include "WaitWord.hpp"
+#include "Stats.hpp"
 
 constexpr const char* SHM_NAME = "/bulls_cows_shm";
-constexpr size_t MAX_CLIENTS = 10;
-constexpr size_t QUEUE_SIZE = 64;
+constexpr uint32_t SHM_MAGIC = 0x42434d53;
+constexpr uint32_t SHM_VERSION = 12;
 constexpr size_t LOGIN_MAX = 32;
-constexpr size_t CMD_MAX = 256;
-constexpr size_t RESP_MAX = 512;
+constexpr size_t RESP_RING_SIZE = 8;
+static_assert((RESP_RING_SIZE & (RESP_RING_SIZE - 1)) == 0, "RESP_RING_SIZE must be a power of two");
+
+// Clients refresh ClientSlot::heartbeat_ns this often; the server reaps a
+// session whose process is gone or whose heartbeat is older than the timeout.
+constexpr int CLIENT_HEARTBEAT_MS = 1000;
+constexpr uint64_t CLIENT_TIMEOUT_NS = 30ull * 1000000000ull;
 
 constexpr int SECRET_LENGTH = 5;
-constexpr int MAX_GAMES = 16;
+constexpr int MAX_PLAYERS = 10;
+
+// Table capacities are chosen by the server at startup and recorded in the
+// segment header; these are the defaults.
+constexpr size_t DEFAULT_MAX_CLIENTS = 10;
+constexpr size_t DEFAULT_MAX_GAMES = 16;
+constexpr size_t DEFAULT_QUEUE_SIZE = 64;
+
+// Game ids handed to clients carry the GameData slot index in the low bits and
+// the slot's generation above it, so an id kept after the game was recycled
+// no longer resolves.
+constexpr int GAME_INDEX_BITS = 20;
+constexpr uint32_t GAME_GENERATION_MASK = 0x7ff;
+constexpr size_t GAME_INDEX_LIMIT = size_t(1) << GAME_INDEX_BITS;
+
+inline int make_game_id(uint32_t generation, int index) {
+    return static_cast<int>(((generation & GAME_GENERATION_MASK) << GAME_INDEX_BITS) | static_cast<uint32_t>(index));
+}
+
+inline int game_index(int game_id) {
+    return game_id & ((1 << GAME_INDEX_BITS) - 1);
+}
+
+inline uint32_t game_generation(int game_id) {
+    return static_cast<uint32_t>(game_id) >> GAME_INDEX_BITS;
+}
 
 enum GameState : uint8_t {
     GAME_WAITING = 0,
@@ -21,21 +56,35 @@ enum GameState : uint8_t {
 };
 
 struct GameData {
+    pthread_mutex_t mutex;
+    // Seqlock over the fields below: odd while a server thread is changing
+    // them (see game_write_lock()), so clients can read without the mutex.
+    std::atomic<uint32_t> seq;
     bool used;
+    std::atomic<uint32_t> generation;
+    std::atomic<int32_t> next_free;
+    int32_t wait_bucket;
+    int32_t wait_prev;
+    int32_t wait_next;
     char game_name[LOGIN_MAX];
-    char players[MAX_CLIENTS][LOGIN_MAX];
+    char players[MAX_PLAYERS][LOGIN_MAX];
     int player_count;
     int max_players;
     GameState state;
     
     char secret[SECRET_LENGTH + 1];
     
-    int attempts[MAX_CLIENTS];
-    bool finished[MAX_CLIENTS];
+    int attempts[MAX_PLAYERS];
+    bool finished[MAX_PLAYERS];
     int winner_index;
     
     time_t start_time;
     time_t end_time;
+    
+    // CLOCK_MONOTONIC, for the server's game timers: when the game entered
+    // its current state, and each seat's last guess (or join).
+    uint64_t state_ns;
+    uint64_t last_move_ns[MAX_PLAYERS];
 };
 
 enum MsgType : uint8_t {
@@ -47,36 +96,371 @@ enum MsgType : uint8_t {
     MSG_GUESS = 6,
     MSG_LEAVE_GAME = 7,
     MSG_GAME_STATUS = 8,
-    MSG_QUIT = 9
+    MSG_QUIT = 9,
+    MSG_BATCH = 10,
+    MSG_HINT = 11,
+    MSG_REAP = 12,      // posted by the server's reaper for a dead session
+    MSG_SUBSCRIBE = 13, // have GameEvents for the sender's games pushed to it
+    MSG_EVENT = 14,     // Response::type of a pushed GameEvent; never sent
+    MSG_NOP = 15        // fills a cell whose producer died before publishing it
+};
+
+inline const char* msg_type_name(uint8_t type) {
+    switch (type) {
+        case MSG_REGISTER: return "register";
+        case MSG_LIST_GAMES: return "list_games";
+        case MSG_CREATE_GAME: return "create_game";
+        case MSG_JOIN_GAME: return "join_game";
+        case MSG_FIND_GAME: return "find_game";
+        case MSG_GUESS: return "guess";
+        case MSG_LEAVE_GAME: return "leave_game";
+        case MSG_GAME_STATUS: return "game_status";
+        case MSG_QUIT: return "quit";
+        case MSG_BATCH: return "batch";
+        case MSG_HINT: return "hint";
+        case MSG_REAP: return "reap";
+        case MSG_SUBSCRIBE: return "subscribe";
+        case MSG_EVENT: return "event";
+        case MSG_NOP: return "nop";
+        default: return "unknown";
+    }
+}
+
+enum Status : uint8_t {
+    ST_OK = 0,
+    ST_UNKNOWN_TYPE,
+    ST_SERVER_FULL,
+    ST_NAME_REQUIRED,
+    ST_INVALID_MAX_PLAYERS,
+    ST_GAMES_FULL,
+    ST_GAME_NOT_FOUND,
+    ST_CANNOT_JOIN,
+    ST_NO_GAMES,
+    ST_NOT_IN_GAME,
+    ST_GAME_NOT_ACTIVE,
+    ST_NOT_IN_THIS_GAME,
+    ST_ALREADY_FINISHED,
+    ST_INVALID_GUESS
+};
+
+// Request bodies, selected by Message::type. Types not listed carry none.
+struct ListGamesRequest {
+    int32_t offset;
+};
+
+struct CreateGameRequest {
+    char game_name[LOGIN_MAX];
+    int32_t max_players;
+};
+
+struct JoinGameRequest {
+    char game_name[LOGIN_MAX];
+};
+
+struct FindGameRequest {
+    int32_t max_players;    // 0 = any size
+};
+
+struct GuessRequest {
+    char word[SECRET_LENGTH + 1];
+};
+
+// MSG_BATCH submits a run of guesses in one message; they are scored in order
+// and answered with a single BatchResult.
+constexpr size_t BATCH_MAX = 8;
+
+struct BatchRequest {
+    int32_t count;
+    GuessRequest guesses[BATCH_MAX];
+};
+
+union RequestBody {
+    ListGamesRequest list;
+    CreateGameRequest create;
+    JoinGameRequest join;
+    FindGameRequest find;
+    GuessRequest guess;
+    BatchRequest batch;
 };
 
+// slot/token identify the sender's ClientSlot as returned by MSG_REGISTER;
+// the server drops messages whose token no longer matches the slot.
+// enqueued_ns is stamped by RequestRing::commit. pid is the sender's
+// process, recorded in its slot at MSG_REGISTER.
 struct Message {
-    bool used;
     char from[LOGIN_MAX];
     char to[LOGIN_MAX];
+    uint64_t enqueued_ns;
+    int32_t pid;
+    uint32_t seq;
+    int32_t slot;
+    uint32_t token;
     uint8_t type;
-    char payload[CMD_MAX];
+    RequestBody body;
+};
+
+// Bounded MPSC ring. A cell is free for ticket `pos` when seq == pos and
+// holds a published message when seq == pos + 1; the consumer hands it back
+// to producers by setting seq = pos + queue size. The cells live in their own
+// table in the segment, see SharedMemoryRoot.
+// owner is the pid of the producer filling the cell, 0 while nobody has
+// claimed it, or CELL_RECLAIMED once the server's reaper has taken over a
+// cell whose producer died; see RequestRing::reclaim().
+constexpr int32_t CELL_RECLAIMED = -1;
+
+struct QueueCell {
+    std::atomic<uint64_t> seq;
+    std::atomic<int32_t> owner;
+    Message msg;
+};
+
+struct RequestQueue {
+    alignas(64) std::atomic<uint64_t> tail;
+    alignas(64) std::atomic<uint64_t> head;
+    WaitWord ready;
+};
+
+// Response bodies, selected by Response::type when status is ST_OK. The
+// server only fills in fields; all text is rendered by the client.
+struct GameRef {
+    int32_t game_id;
+    char game_name[LOGIN_MAX];
+};
+
+enum GuessFlags : uint8_t {
+    GUESS_SOLVED = 1,
+    GUESS_WINNER = 2
+};
+
+struct GuessResult {
+    int32_t attempt;
+    uint8_t bulls;
+    uint8_t cows;
+    uint8_t flags;
+    char secret[SECRET_LENGTH + 1];    // set once solved
+};
+
+struct PlayerStatus {
+    char login[LOGIN_MAX];
+    int32_t attempts;
+    bool finished;
 };
 
+struct GameSnapshot {
+    char game_name[LOGIN_MAX];
+    GameState state;
+    int32_t player_count;
+    int32_t max_players;
+    int32_t winner_index;
+    PlayerStatus players[MAX_PLAYERS];
+};
+
+// MSG_LIST_GAMES is paged: the client asks again from next_offset until it
+// comes back as -1.
+constexpr size_t LIST_PAGE_SIZE = 8;
+
+struct GameSummary {
+    char game_name[LOGIN_MAX];
+    GameState state;
+    int32_t player_count;
+    int32_t max_players;
+};
+
+struct GameList {
+    int32_t next_offset;
+    int32_t count;
+    GameSummary games[LIST_PAGE_SIZE];
+};
+
+struct BatchResult {
+    int32_t count;
+    uint8_t status[BATCH_MAX];
+    GuessResult results[BATCH_MAX];
+};
+
+// MSG_HINT: how many dictionary words are still consistent with the
+// player's replies, and a guess expected to narrow them down well.
+struct HintResult {
+    int32_t remaining;
+    char suggestion[SECRET_LENGTH + 1];
+};
+
+// Pushed by the server to subscribed players of a game as a Response with
+// type MSG_EVENT and seq 0. login is the player the event is about.
+enum EventKind : uint8_t {
+    EVENT_PLAYER_JOINED = 1,
+    EVENT_PLAYER_LEFT,
+    EVENT_GAME_STARTED,
+    EVENT_GAME_WON,         // attempts
+    EVENT_GAME_ENDED,       // time ran out without a winner
+    EVENT_TIMED_OUT,        // the receiver was removed for not guessing
+    EVENT_GAME_CLOSED       // the receiver was removed: lobby expired or finished game recycled
+};
+
+struct GameEvent {
+    int32_t game_id;
+    uint8_t kind;
+    int32_t attempts;
+    int32_t player_count;
+    int32_t max_players;
+    char login[LOGIN_MAX];
+};
+
+union ResponseBody {
+    GameRef game;
+    GuessResult guess;
+    GameSnapshot status;
+    GameList list;
+    BatchResult batch;
+    HintResult hint;
+    GameEvent event;
+};
+
+struct Response {
+    uint32_t seq;
+    int32_t slot;
+    uint32_t token;
+    uint8_t type;
+    uint8_t status;
+    ResponseBody body;
+};
+
+// Responses travel through a per-client SPSC ring: the server advances
+// resp_tail, the client advances resp_head. A client may therefore have up to
+// RESP_RING_SIZE requests in flight, matched to replies by Message::seq.
+// `ready` is notified after a push, once per server batch; the mutex serializes server threads
+// pushing to the same slot and guards current_game_id. With `events` set
+// (MSG_SUBSCRIBE), GameEvents share the ring; they never take its last free
+// entry, which is kept for a reply.
+// generation is bumped every time the slot is handed to a new login or
+// released, and serves as the session token. pid and heartbeat_ns
+// (CLOCK_MONOTONIC) tell the server's reaper whether the client is alive.
+// `used` is written under the mutex but read without it, by the reaper and
+// by session and index lookups on other threads.
 struct ClientSlot {
-    bool used;
+    pthread_mutex_t mutex;
+    WaitWord ready;
+    std::atomic<bool> used;
+    std::atomic<uint32_t> generation;
+    std::atomic<int32_t> next_free;
     char login[LOGIN_MAX];
-    pthread_cond_t cond;
-    char response[RESP_MAX];
-    bool has_response;
+    std::atomic<int32_t> pid;
+    std::atomic<uint64_t> heartbeat_ns;
+    std::atomic<uint32_t> resp_head;
+    std::atomic<uint32_t> resp_tail;
+    Response responses[RESP_RING_SIZE];
     int current_game_id;
+    std::atomic<bool> events;
 };
 
-struct SharedMemoryRoot {
+// Entry of the login -> client slot hash index. hash holds the login's
+// precomputed hash, or INDEX_EMPTY; slot is published before hash so a
+// reader that sees the hash also sees the slot.
+constexpr uint32_t INDEX_EMPTY = 0;
+
+struct ClientIndexEntry {
+    std::atomic<uint32_t> hash;
+    std::atomic<int32_t> slot;
+};
+
+// Heads and tails of the matchmaking lists, indexed by max_players and linked
+// through GameData::wait_prev/wait_next. wait_bucket is -1 while unlisted.
+struct WaitingLists {
     pthread_mutex_t mutex;
-    pthread_cond_t server_cond;
+    int32_t head[MAX_PLAYERS + 1];
+    int32_t tail[MAX_PLAYERS + 1];
+};
+
+// Locking: the request queue is lock-free. Each GameData and each ClientSlot
+// has its own process-shared mutex; wakeups go through WaitWords.
+// Lock order is GameData::mutex before WaitingLists::mutex and
+// ClientSlot::mutex; never hold two game locks or two client locks at the
+// same time. The mutexes are robust and taken with shm_lock(), so a server
+// that died holding one (and was then adopted) does not block the next.
+// Clients never take them: they read games through GameData::seq.
+//
+// The segment starts with this header. The client, client index, game,
+// queue cell and stats tables follow at the recorded offsets, sized from the capacities
+// the server was started with; clients read them from here after attaching.
+struct SharedMemoryRoot {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t layout;
+    uint64_t segment_size;
+    
+    // Process serving the segment, 0 once it has handed it over.
+    std::atomic<int32_t> server_pid;
+    
+    uint32_t max_clients;
+    uint32_t max_games;
+    uint32_t queue_size;
+    uint32_t client_index_size;
+    
+    uint64_t clients_offset;
+    uint64_t client_index_offset;
+    uint64_t games_offset;
+    uint64_t queue_offset;
+    uint64_t stats_offset;
+    
+    RequestQueue queue;
     
-    Message queue[QUEUE_SIZE];
-    size_t q_head;
-    size_t q_tail;
+    FreeList free_clients;
+    WaitWord registrations;
+    std::atomic<uint32_t> client_index_moves;   // see ClientIndex::erase()
     
-    ClientSlot clients[MAX_CLIENTS];
+    FreeList free_games;
+    WaitingLists waiting;
+    std::atomic<size_t> game_count;
     
-    GameData games[MAX_GAMES];
-    size_t game_count;
+    ClientSlot* clients() { return table<ClientSlot>(clients_offset); }
+    ClientIndexEntry* client_index() { return table<ClientIndexEntry>(client_index_offset); }
+    GameData* games() { return table<GameData>(games_offset); }
+    QueueCell* queue_cells() { return table<QueueCell>(queue_offset); }
+    StatsRegion* stats() { return table<StatsRegion>(stats_offset); }
+
+private:
+    template <typename T>
+    T* table(uint64_t offset) {
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(this) + offset);
+    }
 };
+
+// Attributes for the mutexes in shared memory: process-shared, and robust
+// where the platform has robust mutexes (Linux). Without them a process
+// that dies holding one leaves it locked for good.
+inline void shm_mutexattr_init(pthread_mutexattr_t* attr) {
+    pthread_mutexattr_init(attr);
+    pthread_mutexattr_setpshared(attr, PTHREAD_PROCESS_SHARED);
+#ifdef __linux__
+    pthread_mutexattr_setrobust(attr, PTHREAD_MUTEX_ROBUST);
+#endif
+}
+
+// Locks a robust process-shared mutex. If its owner died, the lock is taken
+// over and marked consistent, and the data it guards is used as found. Only
+// server threads hold these locks, so that happens after a crashed server
+// was adopted.
+inline void shm_lock(pthread_mutex_t* mutex) {
+#ifdef __linux__
+    if (pthread_mutex_lock(mutex) == EOWNERDEAD) {
+        pthread_mutex_consistent(mutex);
+    }
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+// Server threads that change a GameData lock it with these instead, which
+// also bump its seq to odd and back to even for lock-free readers
+// (GameReader.hpp). A writer that died mid-change leaves seq odd; the next
+// one moves it on to the following odd value.
+inline void game_write_lock(GameData* gdata) {
+    shm_lock(&gdata->mutex);
+    gdata->seq.store((gdata->seq.load(std::memory_order_relaxed) + 1) | 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+inline void game_write_unlock(GameData* gdata) {
+    gdata->seq.store(gdata->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    pthread_mutex_unlock(&gdata->mutex);
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <csignal>
+#include <pthread.h>
+
+// The server handles SIGINT, SIGTERM and SIGUSR2 on its main thread only:
+// every thread it starts blocks them before doing anything else.
+inline void block_server_signals() {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    sigaddset(&set, SIGUSR2);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+}
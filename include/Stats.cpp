@@ -0,0 +1,20 @@
+#include "Stats.hpp"
+
+uint64_t hist_percentile(const uint64_t* buckets, uint64_t count, double q) {
+    if (count == 0) return 0;
+    
+    uint64_t rank = static_cast<uint64_t>(q * count);
+    if (rank >= count) rank = count - 1;
+    
+    uint64_t seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += buckets[b];
+        if (seen > rank) {
+            // Report the middle of the bucket.
+            uint64_t lo = hist_bucket_floor(b);
+            uint64_t hi = b + 1 < HIST_BUCKETS ? hist_bucket_floor(b + 1) : lo * 2;
+            return lo + (hi - lo) / 2;
+        }
+    }
+    return hist_bucket_floor(HIST_BUCKETS - 1);
+}
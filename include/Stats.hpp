@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+// Server statistics kept in their own table of the segment, written with
+// relaxed atomics by the server threads and read by bc-stats.
+
+inline uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+// Log-linear histogram of nanosecond durations: each power of two is split
+// into HIST_SUB_BUCKETS equal buckets, so any value is within 25% of its
+// bucket's bounds. Values past the last power land in the last bucket.
+constexpr int HIST_SUB_BITS = 2;
+constexpr int HIST_SUB_BUCKETS = 1 << HIST_SUB_BITS;
+constexpr int HIST_POWERS = 42;
+constexpr int HIST_BUCKETS = HIST_SUB_BUCKETS * (HIST_POWERS + 1);
+
+inline int hist_bucket(uint64_t v) {
+    if (v < HIST_SUB_BUCKETS) return static_cast<int>(v);
+    
+    int e = 63 - __builtin_clzll(v);
+    int sub = static_cast<int>(v >> (e - HIST_SUB_BITS)) & (HIST_SUB_BUCKETS - 1);
+    int b = HIST_SUB_BUCKETS * (e - HIST_SUB_BITS + 1) + sub;
+    return b < HIST_BUCKETS ? b : HIST_BUCKETS - 1;
+}
+
+// Smallest value that falls in bucket b.
+inline uint64_t hist_bucket_floor(int b) {
+    if (b < HIST_SUB_BUCKETS) return b;
+    
+    int e = b / HIST_SUB_BUCKETS + HIST_SUB_BITS - 1;
+    return static_cast<uint64_t>(HIST_SUB_BUCKETS + b % HIST_SUB_BUCKETS) << (e - HIST_SUB_BITS);
+}
+
+struct Histogram {
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> buckets[HIST_BUCKETS];
+    
+    void record(uint64_t ns) {
+        buckets[hist_bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(ns, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+// queue_wait: from RequestRing::commit to the start of the handler.
+// handler: time spent in the handler, including delivery.
+// delivery: pushing the reply into the client's ring and waking it.
+struct TypeStats {
+    Histogram queue_wait;
+    Histogram handler;
+    Histogram delivery;
+};
+
+constexpr int STATS_TYPES = 16;    // indexed by MsgType
+
+struct StatsRegion {
+    TypeStats types[STATS_TYPES];
+    std::atomic<int64_t> active_clients;
+    std::atomic<int64_t> games_by_state[3];    // indexed by GameState
+    std::atomic<uint64_t> reaped_clients;
+    std::atomic<uint64_t> journal_dropped;     // records lost to a full journal
+    
+    TypeStats* of(uint8_t type) { return &types[type < STATS_TYPES ? type : 0]; }
+};
+
+// Value below which fraction q of the recorded samples fall, taken from the
+// bucket-wise difference between two snapshots (or one and zeros).
+uint64_t hist_percentile(const uint64_t* buckets, uint64_t count, double q);
@@ -0,0 +1,76 @@
+#pragma once
+#include "Futex.hpp"
+#include <cerrno>
+#include <climits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Wait/notify over a sequence word in shared memory. A waiter takes a key
+// with wait_prepare(), re-checks its condition, then calls wait_until(); any
+// notify after wait_prepare() makes it return. Waiters spin briefly before
+// sleeping on multi-core hosts, and notifiers skip the wake syscall when
+// nobody is asleep.
+struct WaitWord {
+    std::atomic<uint32_t> seq;
+    std::atomic<uint32_t> waiters;
+};
+
+constexpr int WAIT_SPIN_LIMIT = 128;
+
+// Spinning only pays off when the notifier can run on another CPU.
+inline int wait_spin_limit() {
+    static const int limit = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? WAIT_SPIN_LIMIT : 0;
+    return limit;
+}
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#endif
+}
+
+inline struct timespec monotonic_deadline(int timeout_ms) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += timeout_ms / 1000;
+    ts.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+inline uint32_t wait_prepare(WaitWord& w) {
+    return w.seq.load(std::memory_order_acquire);
+}
+
+// Returns false if the deadline passed without a notify.
+inline bool wait_until(WaitWord& w, uint32_t key, const struct timespec* deadline = nullptr) {
+    for (int i = 0, n = wait_spin_limit(); i < n; i++) {
+        if (w.seq.load(std::memory_order_acquire) != key) return true;
+        cpu_relax();
+    }
+    
+    w.waiters.fetch_add(1, std::memory_order_seq_cst);
+    
+    bool notified = true;
+    while (w.seq.load(std::memory_order_seq_cst) == key) {
+        if (futex_wait_until(&w.seq, key, deadline) == -1 && errno == ETIMEDOUT) {
+            notified = w.seq.load(std::memory_order_acquire) != key;
+            break;
+        }
+    }
+    
+    w.waiters.fetch_sub(1, std::memory_order_relaxed);
+    return notified;
+}
+
+inline void notify(WaitWord& w, int count = INT_MAX) {
+    w.seq.fetch_add(1, std::memory_order_seq_cst);
+    if (w.waiters.load(std::memory_order_seq_cst)) {
+        futex_wake(&w.seq, count);
+    }
+}
@@ -0,0 +1,157 @@
+#include "CandidateSet.hpp"
+#include <algorithm>
+
+// Bounds on the work suggest() does: how many remaining words are tried as
+// guesses, and how many they are scored against.
+constexpr size_t SUGGEST_PROBES = 48;
+constexpr size_t SUGGEST_TARGETS = 512;
+
+// Scratch space reused by every set scored on this thread.
+static thread_local std::vector<PackedWord> scratch_words;
+static thread_local std::vector<uint32_t> scratch_ids;
+static thread_local std::vector<uint32_t> scratch_kept;
+static thread_local std::vector<Score> scratch_scores;
+
+void CandidateSet::reset() {
+    full = true;
+    count = 0;
+    ids.clear();
+    ids.shrink_to_fit();
+    bits.clear();
+    bits.shrink_to_fit();
+}
+
+size_t CandidateSet::size() const {
+    return full ? Dictionary::shared().size() : count;
+}
+
+void CandidateSet::narrow(PackedWord guess, Score score) {
+    const Dictionary& dictionary = Dictionary::shared();
+    const PackedWord* words = dictionary.data();
+    size_t n = size();
+    
+    scratch_scores.resize(n);
+    scratch_kept.clear();
+    
+    if (full) {
+        GuessScorer(guess).score_batch(words, n, scratch_scores.data());
+        for (size_t i = 0; i < n; i++) {
+            if (scratch_scores[i].bulls == score.bulls && scratch_scores[i].cows == score.cows) {
+                scratch_kept.push_back(static_cast<uint32_t>(i));
+            }
+        }
+    } else {
+        scratch_words.clear();
+        scratch_ids.clear();
+        for_each([&](uint32_t i) {
+            scratch_ids.push_back(i);
+            scratch_words.push_back(words[i]);
+        });
+        
+        GuessScorer(guess).score_batch(scratch_words.data(), n, scratch_scores.data());
+        for (size_t i = 0; i < n; i++) {
+            if (scratch_scores[i].bulls == score.bulls && scratch_scores[i].cows == score.cows) {
+                scratch_kept.push_back(scratch_ids[i]);
+            }
+        }
+    }
+    
+    store(scratch_kept);
+}
+
+// A sorted array costs 32 bits per word and a bitmap one bit per dictionary
+// word, so the array wins below size / 32 words.
+void CandidateSet::store(const std::vector<uint32_t>& kept) {
+    size_t universe = Dictionary::shared().size();
+    full = false;
+    count = kept.size();
+    
+    if (count > universe / 32) {
+        ids.clear();
+        ids.shrink_to_fit();
+        bits.assign((universe + 63) / 64, 0);
+        for (uint32_t i : kept) {
+            bits[i / 64] |= uint64_t(1) << (i % 64);
+        }
+    } else {
+        bits.clear();
+        bits.shrink_to_fit();
+        ids.assign(kept.begin(), kept.end());
+    }
+}
+
+void CandidateSet::save(std::vector<uint32_t>& out) const {
+    if (full) {
+        out.push_back(CANDIDATES_FULL);
+        return;
+    }
+    out.push_back(static_cast<uint32_t>(count));
+    for_each([&](uint32_t i) { out.push_back(i); });
+}
+
+bool CandidateSet::load(const uint32_t*& in, const uint32_t* end) {
+    if (in == end) return false;
+    
+    uint32_t n = *in++;
+    if (n == CANDIDATES_FULL) {
+        reset();
+        return true;
+    }
+    if (static_cast<size_t>(end - in) < n) return false;
+    
+    scratch_kept.assign(in, in + n);
+    in += n;
+    for (uint32_t i : scratch_kept) {
+        if (i >= Dictionary::shared().size()) return false;
+    }
+    store(scratch_kept);
+    return true;
+}
+
+PackedWord CandidateSet::suggest() const {
+    size_t n = size();
+    if (n == 0) return 0;
+    
+    const PackedWord* words = Dictionary::shared().data();
+    scratch_words.clear();
+    scratch_words.reserve(n);
+    for_each([&](uint32_t i) { scratch_words.push_back(words[i]); });
+    if (n <= 2) return scratch_words[0];
+    
+    // Evenly spaced samples of the remaining words serve as both the
+    // guesses tried and the secrets they are scored against. Steps round up
+    // so neither sample exceeds its bound: at most SUGGEST_PROBES guesses
+    // scored against SUGGEST_TARGETS words each.
+    std::vector<PackedWord> targets;
+    size_t step = (n + SUGGEST_TARGETS - 1) / SUGGEST_TARGETS;
+    for (size_t i = 0; i < n; i += step) {
+        targets.push_back(scratch_words[i]);
+    }
+    scratch_scores.resize(targets.size());
+    
+    PackedWord best = scratch_words[0];
+    size_t best_cost = SIZE_MAX;
+    size_t probe_step = (n + SUGGEST_PROBES - 1) / SUGGEST_PROBES;
+    
+    for (size_t p = 0; p < n; p += probe_step) {
+        GuessScorer(scratch_words[p]).score_batch(targets.data(), targets.size(), scratch_scores.data());
+        
+        // Sum of squared group sizes is proportional to the expected number
+        // of words left after this guess.
+        size_t groups[(SECRET_LENGTH + 1) * (SECRET_LENGTH + 1)] = {};
+        for (const Score& s : scratch_scores) {
+            groups[s.bulls * (SECRET_LENGTH + 1) + s.cows]++;
+        }
+        size_t cost = 0;
+        for (size_t g : groups) {
+            cost += g * g;
+        }
+        
+        if (cost < best_cost) {
+            best_cost = cost;
+            best = scratch_words[p];
+        }
+    }
+    
+    return best;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "../include/Dictionary.hpp"
+#include <cstdint>
+#include <vector>
+
+// The dictionary words a player's replies so far have not ruled out, as
+// indices into Dictionary::shared(). Like a roaring container it is stored
+// as whichever is smaller: a sorted index array while sparse, a bitmap
+// while dense, and nothing at all before the first reply. A set never
+// costs more than one bit per dictionary word.
+class CandidateSet {
+public:
+    CandidateSet() : full(true), count(0) {}
+    
+    void reset();
+    
+    // Keeps the words that would have given `score` for `guess`.
+    void narrow(PackedWord guess, Score score);
+    
+    size_t size() const;
+    
+    // Calls fn(index) for every remaining word, in index order.
+    template <typename Fn>
+    void for_each(Fn fn) const;
+    
+    // A guess that splits the remaining words into the smallest expected
+    // group, judged on a bounded sample. Returns 0 when nothing remains.
+    PackedWord suggest() const;
+    
+    // Serialized form for server snapshots: the count, or CANDIDATES_FULL
+    // before the first reply, followed by that many indices. load() returns
+    // false on malformed input and leaves `in` past the set.
+    static constexpr uint32_t CANDIDATES_FULL = 0xffffffff;
+    void save(std::vector<uint32_t>& out) const;
+    bool load(const uint32_t*& in, const uint32_t* end);
+
+private:
+    bool full;
+    size_t count;
+    std::vector<uint32_t> ids;       // sparse form, sorted
+    std::vector<uint64_t> bits;      // dense form
+    
+    void store(const std::vector<uint32_t>& kept);
+};
+
+template <typename Fn>
+void CandidateSet::for_each(Fn fn) const {
+    if (full) {
+        for (size_t i = 0; i < Dictionary::shared().size(); i++) fn(static_cast<uint32_t>(i));
+    } else if (!bits.empty()) {
+        for (size_t w = 0; w < bits.size(); w++) {
+            for (uint64_t b = bits[w]; b; b &= b - 1) {
+                fn(static_cast<uint32_t>(w * 64 + __builtin_ctzll(b)));
+            }
+        }
+    } else {
+        for (uint32_t i : ids) fn(i);
+    }
+}
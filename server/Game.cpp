@@ -1,26 +1,12 @@
 #include "Game.hpp"
-#include <sstream>
+#include "../include/Dictionary.hpp"
+#include "../include/GameReader.hpp"
 
-Game::Game(GameData* data) : data(data) {
+Game::Game(GameData* data, StatsRegion* stats) : data(data), stats(stats), candidates(MAX_PLAYERS) {
 }
 
-std::string Game::generate_secret() {
-    std::vector<std::string> words = {
-        "apple", "beach", "chair", "dance", "earth",
-        "flame", "grace", "house", "image", "juice",
-        "knife", "lemon", "music", "night", "ocean",
-        "pearl", "queen", "river", "stone", "table",
-        "unity", "voice", "water", "youth", "zebra",
-        "bread", "cloud", "dream", "field", "globe",
-        "heart", "light", "magic", "paint", "smile",
-        "storm", "tiger", "tower", "whale", "world"
-    };
-    
-    std::random_device rd;
-    std::mt19937 g(rd());
-    std::uniform_int_distribution<> dis(0, words.size() - 1);
-    
-    return words[dis(g)];
+PackedWord Game::generate_secret() {
+    return Dictionary::shared().random_word();
 }
 
 bool Game::add_player(const std::string& login) {
@@ -36,19 +22,22 @@ bool Game::add_player(const std::string& login) {
     
     strncpy(data->players[data->player_count], login.c_str(), LOGIN_MAX - 1);
     data->players[data->player_count][LOGIN_MAX - 1] = '\0';
+    data->last_move_ns[data->player_count] = monotonic_ns();
     data->player_count++;
     
     return true;
 }
 
 bool Game::remove_player(const std::string& login) {
-    int idx = find_player_index(login);
+    int idx = find_player_index(login.c_str());
     if (idx == -1) return false;
     
     for (int i = idx; i < data->player_count - 1; i++) {
         strcpy(data->players[i], data->players[i + 1]);
         data->attempts[i] = data->attempts[i + 1];
         data->finished[i] = data->finished[i + 1];
+        data->last_move_ns[i] = data->last_move_ns[i + 1];
+        candidates[i] = std::move(candidates[i + 1]);
     }
     data->player_count--;
     
@@ -74,107 +63,140 @@ bool Game::can_start() const {
 }
 
 void Game::start_game() {
+    char secret[SECRET_LENGTH + 1];
+    unpack_word(generate_secret(), secret);
+    start_game(secret);
+}
+
+void Game::start_game(const char* secret) {
     if (!can_start()) return;
     
-    std::string secret = generate_secret();
-    strncpy(data->secret, secret.c_str(), SECRET_LENGTH);
+    memcpy(data->secret, secret, SECRET_LENGTH);
     data->secret[SECRET_LENGTH] = '\0';
     
+    uint64_t now = monotonic_ns();
     for (int i = 0; i < data->player_count; i++) {
         data->attempts[i] = 0;
         data->finished[i] = false;
+        data->last_move_ns[i] = now;
+        candidates[i].reset();
     }
     
     data->winner_index = -1;
-    data->state = GAME_ACTIVE;
+    set_state(GAME_ACTIVE);
     data->start_time = time(nullptr);
 }
 
-int Game::find_player_index(const std::string& player) const {
+void Game::end_game() {
+    if (data->state != GAME_ACTIVE) return;
+    
+    set_state(GAME_FINISHED);
+    data->end_time = time(nullptr);
+}
+
+// Keeps the per-state game counts in the stats region in step.
+void Game::set_state(GameState state) {
+    if (stats) {
+        stats->games_by_state[data->state].fetch_sub(1, std::memory_order_relaxed);
+        stats->games_by_state[state].fetch_add(1, std::memory_order_relaxed);
+    }
+    data->state = state;
+    data->state_ns = monotonic_ns();
+}
+
+int Game::find_player_index(const char* player) const {
     for (int i = 0; i < data->player_count; i++) {
-        if (strcmp(data->players[i], player.c_str()) == 0) {
+        if (strcmp(data->players[i], player) == 0) {
             return i;
         }
     }
     return -1;
 }
 
-bool Game::is_valid_guess(const std::string& guess) const {
-    if (guess.length() != SECRET_LENGTH) return false;
+bool Game::is_valid_guess(const char* guess) {
+    if (strnlen(guess, SECRET_LENGTH + 1) != SECRET_LENGTH) return false;
     
-    for (char c : guess) {
-        if (!islower(c) || !isalpha(c)) return false;
+    for (int i = 0; i < SECRET_LENGTH; i++) {
+        if (!islower(guess[i]) || !isalpha(guess[i])) return false;
     }
     
-    return true;
+    return Dictionary::shared().contains(pack_word(guess));
 }
 
-std::pair<int, int> Game::calculate_bulls_and_cows(const std::string& secret, const std::string& guess) {
-    int bulls = 0, cows = 0;
-    
-    for (int i = 0; i < SECRET_LENGTH; i++) {
-        if (secret[i] == guess[i]) {
-            bulls++;
-        } else {
-            for (int j = 0; j < SECRET_LENGTH; j++) {
-                if (i != j && secret[i] == guess[j]) {
-                    cows++;
-                    break;
-                }
-            }
-        }
-    }
-    
-    return {bulls, cows};
+Score Game::calculate_bulls_and_cows(const char* secret, const char* guess) {
+    return score_guess(pack_word(secret), pack_word(guess));
 }
 
-std::string Game::make_guess(const std::string& player, const std::string& guess) {
+Status Game::make_guess(const char* player, const char* guess, GuessResult& out) {
     if (data->state != GAME_ACTIVE) {
-        return "ERROR: Game is not active";
+        return ST_GAME_NOT_ACTIVE;
     }
     
     int idx = find_player_index(player);
     if (idx == -1) {
-        return "ERROR: You are not in this game";
+        return ST_NOT_IN_THIS_GAME;
     }
     
     if (data->finished[idx]) {
-        return "INFO: You already finished!";
+        return ST_ALREADY_FINISHED;
     }
     
     if (!is_valid_guess(guess)) {
-        return "ERROR: Invalid guess. Must be a 5-letter word in lowercase";
+        return ST_INVALID_GUESS;
     }
     
     data->attempts[idx]++;
+    data->last_move_ns[idx] = monotonic_ns();
+    
+    Score score = calculate_bulls_and_cows(data->secret, guess);
     
-    std::string secret = std::string(data->secret);
-    auto [bulls, cows] = calculate_bulls_and_cows(secret, guess);
+    out.attempt = data->attempts[idx];
+    out.bulls = score.bulls;
+    out.cows = score.cows;
+    out.flags = 0;
     
-    std::ostringstream oss;
-    oss << "Attempt #" << data->attempts[idx] << " - Bulls: " << bulls << ", Cows: " << cows;
+    if (score.bulls < SECRET_LENGTH) {
+        candidates[idx].narrow(pack_word(guess), score);
+    }
     
-    if (bulls == SECRET_LENGTH) {
+    if (score.bulls == SECRET_LENGTH) {
         data->finished[idx] = true;
+        out.flags |= GUESS_SOLVED;
+        memcpy(out.secret, data->secret, sizeof(out.secret));
         
-        if (data->winner_index == -1) {
-            data->winner_index = idx;
-            oss << "\n🎉 CONGRATULATIONS! You are the WINNER! You guessed the word: \"" << secret 
-                << "\" in " << data->attempts[idx] << " attempts!";
-            
-            data->state = GAME_FINISHED;
-            data->end_time = time(nullptr);
-        } else {
-            oss << "\nYou guessed the word \"" << secret << "\", but " 
-                << data->players[data->winner_index] << " was faster!";
-        }
+        // The first player to solve the word wins and ends the game.
+        data->winner_index = idx;
+        out.flags |= GUESS_WINNER;
+        
+        set_state(GAME_FINISHED);
+        data->end_time = time(nullptr);
     }
     
-    return oss.str();
+    return ST_OK;
 }
 
-bool Game::is_player_finished(const std::string& player) const {
+Status Game::get_hint(const char* player, HintResult& out) const {
+    if (data->state != GAME_ACTIVE) {
+        return ST_GAME_NOT_ACTIVE;
+    }
+    
     int idx = find_player_index(player);
+    if (idx == -1) {
+        return ST_NOT_IN_THIS_GAME;
+    }
+    
+    if (data->finished[idx]) {
+        return ST_ALREADY_FINISHED;
+    }
+    
+    const CandidateSet& set = candidates[idx];
+    out.remaining = static_cast<int32_t>(set.size());
+    unpack_word(set.suggest(), out.suggestion);
+    return ST_OK;
+}
+
+bool Game::is_player_finished(const std::string& player) const {
+    int idx = find_player_index(player.c_str());
     if (idx == -1) return false;
     return data->finished[idx];
 }
@@ -183,34 +205,19 @@ bool Game::is_game_finished() const {
     return data->state == GAME_FINISHED;
 }
 
-std::string Game::get_status() const {
-    std::ostringstream oss;
-    oss << "Game: " << data->game_name << "\n";
-    oss << "State: ";
-    
-    switch (data->state) {
-        case GAME_WAITING: oss << "Waiting for players"; break;
-        case GAME_ACTIVE: oss << "Active"; break;
-        case GAME_FINISHED: oss << "Finished"; break;
-    }
-    
-    oss << "\nPlayers (" << data->player_count << "/" << data->max_players << "):\n";
-    
+void Game::get_status(GameSnapshot& out) const {
+    fill_game_snapshot(*data, out);
+}
+
+void Game::save_candidates(std::vector<uint32_t>& out) const {
     for (int i = 0; i < data->player_count; i++) {
-        oss << "  - " << data->players[i] 
-            << " (attempts: " << data->attempts[i];
-        if (i == data->winner_index) {
-            oss << ", 🏆 WINNER! ✓";
-        } else if (data->finished[i]) {
-            oss << ", finished";
-        }
-        oss << ")\n";
+        candidates[i].save(out);
     }
-    
-    if (data->state == GAME_FINISHED && data->winner_index >= 0) {
-        oss << "\n🏆 Winner: " << data->players[data->winner_index] 
-            << " guessed the word in " << data->attempts[data->winner_index] << " attempts!";
+}
+
+bool Game::load_candidates(const uint32_t*& in, const uint32_t* end) {
+    for (int i = 0; i < data->player_count; i++) {
+        if (!candidates[i].load(in, end)) return false;
     }
-    
-    return oss.str();
+    return true;
 }
@@ -1,29 +1,46 @@
 #pragma once
 #include "../include/SharedTypes.hpp"
+#include "../include/Scoring.hpp"
+#include "CandidateSet.hpp"
 #include <string>
 #include <vector>
-#include <random>
 
 class Game {
 public:
-    Game(GameData* data);
+    Game(GameData* data, StatsRegion* stats = nullptr);
     
     bool add_player(const std::string& login);
     bool remove_player(const std::string& login);
     bool is_full() const;
     bool can_start() const;
     void start_game();
+    // Starts with a known secret, as recorded in the server journal.
+    void start_game(const char* secret);
+    // Ends an active game without a winner, e.g. when its time runs out.
+    void end_game();
     
-    std::string make_guess(const std::string& player, const std::string& guess);
+    Status make_guess(const char* player, const char* guess, GuessResult& out);
+    Status get_hint(const char* player, HintResult& out) const;
     bool is_player_finished(const std::string& player) const;
     bool is_game_finished() const;
-    std::string get_status() const;
+    void get_status(GameSnapshot& out) const;
     
+    // Candidate sets of the seated players in seat order, for snapshots.
+    void save_candidates(std::vector<uint32_t>& out) const;
+    bool load_candidates(const uint32_t*& in, const uint32_t* end);
+    
+    // Stateless helpers, public so the micro-benchmarks can reach them.
+    static PackedWord generate_secret();
+    static bool is_valid_guess(const char* guess);
+    static Score calculate_bulls_and_cows(const char* secret, const char* guess);
+
 private:
     GameData* data;
+    StatsRegion* stats;
+    
+    // Per player, parallel to data->players; narrowed by every scored guess.
+    std::vector<CandidateSet> candidates;
     
-    std::string generate_secret();
-    bool is_valid_guess(const std::string& guess) const;
-    std::pair<int, int> calculate_bulls_and_cows(const std::string& secret, const std::string& guess);
-    int find_player_index(const std::string& player) const;
+    int find_player_index(const char* player) const;
+    void set_state(GameState state);
 };
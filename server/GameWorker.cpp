@@ -0,0 +1,70 @@
+#include "GameWorker.hpp"
+#include "../include/Signals.hpp"
+
+GameWorker::GameWorker(Handler handler, std::function<void()> batch_done)
+    : handler(std::move(handler)), batch_done(std::move(batch_done)), stopping(false), paused(false), parked(false) {
+    thread = std::thread(&GameWorker::loop, this);
+}
+
+GameWorker::~GameWorker() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cond.notify_one();
+    
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void GameWorker::post(const Message& m, int game_id) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inbox.push_back(Job{m, game_id});
+    }
+    cond.notify_one();
+}
+
+void GameWorker::pause() {
+    std::unique_lock<std::mutex> lock(mutex);
+    paused = true;
+    cond.notify_one();
+    parked_cond.wait(lock, [this] { return parked; });
+}
+
+void GameWorker::resume() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        paused = false;
+    }
+    cond.notify_one();
+}
+
+void GameWorker::loop() {
+    block_server_signals();
+    std::deque<Job> batch;
+    
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [this] { return stopping || paused || !inbox.empty(); });
+            
+            if (paused && !stopping) {
+                parked = true;
+                parked_cond.notify_all();
+                cond.wait(lock, [this] { return stopping || !paused; });
+                parked = false;
+                continue;
+            }
+            if (inbox.empty()) return;
+            batch.swap(inbox);
+        }
+        
+        for (const Job& job : batch) {
+            handler(job.m, job.game_id);
+        }
+        batch_done();
+        batch.clear();
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "../include/SharedTypes.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// A server thread that owns a shard of games. The dispatcher copies every
+// in-game message for game_id into worker game_id % N, so all guesses for
+// one game are handled in order on the same thread. The handler gets the
+// game_id the message was routed by. batch_done runs after each batch taken
+// from the inbox.
+class GameWorker {
+public:
+    using Handler = std::function<void(const Message&, int game_id)>;
+    
+    GameWorker(Handler handler, std::function<void()> batch_done);
+    ~GameWorker();
+    
+    void post(const Message& m, int game_id);
+    
+    // pause() returns once the worker has finished its current batch; it
+    // handles nothing more until resume(). Used to take consistent snapshots.
+    void pause();
+    void resume();
+
+private:
+    struct Job {
+        Message m;
+        int game_id;
+    };
+    
+    Handler handler;
+    std::function<void()> batch_done;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::condition_variable parked_cond;
+    std::deque<Job> inbox;
+    bool stopping;
+    bool paused;
+    bool parked;
+    std::thread thread;
+    
+    void loop();
+};
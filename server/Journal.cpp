@@ -0,0 +1,294 @@
+#include "Journal.hpp"
+#include "../include/Logger.hpp"
+#include "../include/Signals.hpp"
+#include "../include/Stats.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char JOURNAL_MAGIC[8] = {'B', 'C', 'J', 'R', 'N', 'L', '0', '2'};
+constexpr size_t JOURNAL_DATA_OFFSET = 4096;
+
+bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool sync_dir(const std::string& dir) {
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd == -1) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+}
+
+// FNV-1a over everything after the checksum field.
+uint32_t journal_checksum(const JournalRecord& r) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(&r) + offsetof(JournalRecord, type);
+    const unsigned char* end = reinterpret_cast<const unsigned char*>(&r) + sizeof(r);
+    
+    uint32_t h = 2166136261u;
+    for (; p < end; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return h;
+}
+
+Journal::Journal()
+    : fd(-1), header(nullptr), records(nullptr), map_size(0), capacity(0), next(0), base(0), synced(0), full(false),
+      snapshot_lsn(0), snapshot_pending(false), last_snapshot_ns(0), snapshot_failed(false), snapshot_done{}, wake{},
+      stopping(false) {
+}
+
+Journal::~Journal() {
+    close();
+}
+
+void Journal::close() {
+    if (!records) return;
+    
+    stopping.store(true);
+    notify(wake);
+    syncer.join();
+    sync();
+    if (snapshot_pending.load(std::memory_order_acquire)) {
+        write_snapshot();
+    }
+    
+    munmap(header, map_size);
+    ::close(fd);
+    header = nullptr;
+    records = nullptr;
+    fd = -1;
+}
+
+bool Journal::open(const std::string& path, size_t capacity) {
+    dir = path;
+    mkdir(dir.c_str(), 0755);
+    
+    fd = ::open((dir + "/journal").c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd == -1) return false;
+    
+    // An existing journal keeps its own capacity.
+    JournalHeader existing = {};
+    bool valid = pread(fd, &existing, sizeof(existing), 0) == sizeof(existing) &&
+                 memcmp(existing.magic, JOURNAL_MAGIC, sizeof(existing.magic)) == 0 &&
+                 existing.record_size == sizeof(JournalRecord) && existing.capacity > 0;
+    if (valid) {
+        capacity = existing.capacity;
+    }
+    this->capacity = capacity;
+    
+    map_size = JOURNAL_DATA_OFFSET + capacity * sizeof(JournalRecord);
+    if (ftruncate(fd, map_size) == -1) {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    
+    void* mapped = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    header = static_cast<JournalHeader*>(mapped);
+    records = reinterpret_cast<JournalRecord*>(static_cast<char*>(mapped) + JOURNAL_DATA_OFFSET);
+    
+    if (!valid) {
+        memset(mapped, 0, map_size);
+        memcpy(header->magic, JOURNAL_MAGIC, sizeof(header->magic));
+        header->record_size = sizeof(JournalRecord);
+        header->capacity = static_cast<uint32_t>(capacity);
+        header->base_lsn = 1;
+        msync(mapped, map_size, MS_SYNC);
+    }
+    
+    // New records go after the last complete one. Anything further on was
+    // written after a record that never completed, so replay must not see
+    // it once new records fill the gap.
+    uint64_t end = header->base_lsn;
+    while (end - header->base_lsn < capacity && records[end % capacity].lsn == end &&
+           records[end % capacity].checksum == journal_checksum(records[end % capacity])) {
+        end++;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        if (records[i].lsn >= end) records[i].lsn = 0;
+    }
+    msync(records, capacity * sizeof(JournalRecord), MS_SYNC);
+    
+    next.store(end, std::memory_order_relaxed);
+    base.store(header->base_lsn, std::memory_order_relaxed);
+    synced = end;
+    full.store(false, std::memory_order_relaxed);
+    last_snapshot_ns.store(monotonic_ns(), std::memory_order_relaxed);
+    stopping.store(false);
+    
+    syncer = std::thread(&Journal::sync_loop, this);
+    return true;
+}
+
+bool Journal::append(JournalRecord& r) {
+    uint64_t lsn = next.fetch_add(1, std::memory_order_relaxed);
+    
+    while (lsn >= base.load(std::memory_order_acquire) + capacity) {
+        uint32_t key = wait_prepare(snapshot_done);
+        if (lsn < base.load(std::memory_order_acquire) + capacity) break;
+        if (!snapshot_pending.load(std::memory_order_acquire)) {
+            full.store(true, std::memory_order_relaxed);
+            return false;
+        }
+        wait_until(snapshot_done, key);
+    }
+    
+    r.checksum = journal_checksum(r);
+    r.lsn = 0;
+    
+    JournalRecord& slot = records[lsn % capacity];
+    memcpy(&slot, &r, sizeof(r));
+    __atomic_store_n(&slot.lsn, lsn, __ATOMIC_RELEASE);
+    return true;
+}
+
+uint64_t Journal::last_lsn() const {
+    return next.load(std::memory_order_acquire) - 1;
+}
+
+// Due once the journal is half full, has dropped a record, or has not been
+// compacted for a while; after a failed attempt, retried at most once a
+// second. Never while the previous snapshot is still being written.
+bool Journal::should_snapshot() const {
+    if (snapshot_pending.load(std::memory_order_acquire)) return false;
+    
+    uint64_t written = next.load(std::memory_order_relaxed) - base.load(std::memory_order_relaxed);
+    if (written == 0) return false;
+    
+    uint64_t since = monotonic_ns() - last_snapshot_ns.load(std::memory_order_relaxed);
+    if (full.load(std::memory_order_relaxed) || written >= capacity / 2) {
+        return !snapshot_failed.load(std::memory_order_relaxed) || since >= SNAPSHOT_RETRY_NS;
+    }
+    return since >= SNAPSHOT_INTERVAL_NS;
+}
+
+// Syncs the pages holding records published since the last call. It stops
+// at the first record still being copied in, which the next round picks up.
+void Journal::sync() {
+    std::lock_guard<std::mutex> lock(sync_mutex);
+    
+    uint64_t end = next.load(std::memory_order_acquire);
+    uint64_t published = synced;
+    while (published < end &&
+           __atomic_load_n(&records[published % capacity].lsn, __ATOMIC_ACQUIRE) == published) {
+        published++;
+    }
+    if (published == synced) return;
+    
+    // The range may wrap around the end of the ring.
+    uint64_t wrap = synced - synced % capacity + capacity;
+    if (published > wrap) {
+        sync_records(synced, wrap);
+        sync_records(wrap, published);
+    } else {
+        sync_records(synced, published);
+    }
+    synced = published;
+}
+
+void Journal::sync_records(uint64_t from, uint64_t to) {
+    long page = sysconf(_SC_PAGESIZE);
+    uintptr_t start = reinterpret_cast<uintptr_t>(&records[from % capacity]) & ~uintptr_t(page - 1);
+    uintptr_t stop = reinterpret_cast<uintptr_t>(&records[from % capacity]) + (to - from) * sizeof(JournalRecord);
+    msync(reinterpret_cast<void*>(start), stop - start, MS_SYNC);
+}
+
+void Journal::sync_loop() {
+    block_server_signals();
+    while (!stopping.load()) {
+        uint32_t key = wait_prepare(wake);
+        sync();
+        if (snapshot_pending.load(std::memory_order_acquire)) {
+            write_snapshot();
+        }
+        
+        struct timespec deadline = monotonic_deadline(JOURNAL_SYNC_MS);
+        wait_until(wake, key, &deadline);
+    }
+}
+
+void Journal::queue_snapshot(std::string&& data, uint64_t lsn) {
+    while (snapshot_pending.load(std::memory_order_acquire)) {
+        uint32_t key = wait_prepare(snapshot_done);
+        if (!snapshot_pending.load(std::memory_order_acquire)) break;
+        wait_until(snapshot_done, key);
+    }
+    
+    snapshot_data = std::move(data);
+    snapshot_lsn = lsn;
+    snapshot_pending.store(true, std::memory_order_release);
+    notify(wake);
+}
+
+// Runs on the flusher thread (or in close()), so the writes and fsyncs
+// never hold up a request. Records up to the snapshot's lsn are covered
+// once it is renamed into place; a crash before the header reaches the
+// disk only means replay skips them by lsn.
+void Journal::write_snapshot() {
+    std::string path = dir + "/snapshot";
+    std::string tmp = path + ".tmp";
+    
+    bool ok = false;
+    int out = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out != -1) {
+        ok = write_all(out, snapshot_data.data(), snapshot_data.size()) && fsync(out) == 0;
+        ::close(out);
+        ok = ok && rename(tmp.c_str(), path.c_str()) == 0 && sync_dir(dir);
+    }
+    
+    if (ok) {
+        std::lock_guard<std::mutex> lock(sync_mutex);
+        header->base_lsn = snapshot_lsn + 1;
+        msync(header, JOURNAL_DATA_OFFSET, MS_SYNC);
+        base.store(snapshot_lsn + 1, std::memory_order_release);
+        synced = std::max(synced, snapshot_lsn + 1);
+        full.store(false, std::memory_order_relaxed);
+        log_event(EV_SNAPSHOT, static_cast<int64_t>(snapshot_lsn));
+    } else {
+        log_event(EV_SNAPSHOT_FAILED);
+    }
+    
+    snapshot_failed.store(!ok, std::memory_order_relaxed);
+    last_snapshot_ns.store(monotonic_ns(), std::memory_order_relaxed);
+    std::string().swap(snapshot_data);
+    snapshot_pending.store(false, std::memory_order_release);
+    notify(snapshot_done);
+}
+
+bool Journal::read_snapshot(std::string& data) const {
+    int in = ::open((dir + "/snapshot").c_str(), O_RDONLY);
+    if (in == -1) return false;
+    
+    struct stat st;
+    bool ok = fstat(in, &st) == 0;
+    if (ok) {
+        data.resize(st.st_size);
+        ok = pread(in, &data[0], data.size(), 0) == static_cast<ssize_t>(data.size());
+    }
+    ::close(in);
+    return ok;
+}
@@ -0,0 +1,175 @@
+#pragma once
+#include "../include/SharedTypes.hpp"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Durable record of the server state, kept in a directory next to the
+// shared memory segment: a snapshot of every used slot, plus an append-only
+// journal of the state changes made since. A restarted server loads the
+// snapshot and replays the journal tail on top of it.
+//
+// The journal is a memory-mapped ring of fixed-size records, record lsn
+// living at records[lsn % capacity]. Request threads only copy a record into
+// the mapping; a background flusher thread msyncs what has been written
+// every JOURNAL_SYNC_MS, so a whole group of records commits in one call and
+// the request path never waits on the disk. The flusher also writes the
+// snapshots the coordinator copies out of the segment, and only then frees
+// the ring space of the records they cover.
+
+enum JournalType : uint8_t {
+    JR_REGISTER = 1,    // index: client slot, generation, name: login
+    JR_QUIT,            // index: client slot
+    JR_CREATE,          // index: game slot, generation, value: max_players, name: game, text: creator
+    JR_JOIN,            // index: game slot, name: login
+    JR_START,           // index: game slot, text: secret
+    JR_GUESS,           // index: game slot, name: login, text: guess; a winning guess finishes the game
+    JR_LEAVE,           // value: game id, name: login
+    JR_FINISH           // index: game slot; the game ran out of time
+};
+
+// lsn numbers records from 1 and is stored last, so a record whose lsn and
+// checksum do not match was never completely written.
+struct JournalRecord {
+    uint64_t lsn;
+    uint32_t checksum;
+    uint8_t type;
+    int32_t index;
+    int32_t value;
+    uint32_t generation;
+    char name[LOGIN_MAX];
+    char text[LOGIN_MAX];
+};
+
+struct JournalHeader {
+    char magic[8];
+    uint32_t record_size;
+    uint32_t capacity;
+    uint64_t base_lsn;      // oldest record not covered by the snapshot
+};
+
+// Snapshot file: the header, the generation of every game slot, then one
+// SnapshotClient per used client slot and one SnapshotGame per used game,
+// each game followed by candidate_words words of Game::save_candidates().
+constexpr char SNAPSHOT_MAGIC[8] = {'B', 'C', 'S', 'N', 'A', 'P', '0', '1'};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint64_t lsn;               // last journal record included
+    uint32_t max_games;
+    uint32_t client_count;
+    uint32_t game_count;
+    uint32_t dictionary_size;   // candidate sets are only kept if it matches
+};
+
+struct SnapshotClient {
+    int32_t slot;
+    uint32_t generation;
+    int32_t game_id;
+    char login[LOGIN_MAX];
+};
+
+struct SnapshotGame {
+    int32_t index;
+    char game_name[LOGIN_MAX];
+    char players[MAX_PLAYERS][LOGIN_MAX];
+    int32_t player_count;
+    int32_t max_players;
+    GameState state;
+    char secret[SECRET_LENGTH + 1];
+    int32_t attempts[MAX_PLAYERS];
+    bool finished[MAX_PLAYERS];
+    int32_t winner_index;
+    int64_t start_time;
+    int64_t end_time;
+    uint32_t candidate_words;
+};
+
+constexpr size_t JOURNAL_DEFAULT_CAPACITY = 1 << 18;
+constexpr int JOURNAL_SYNC_MS = 5;
+constexpr uint64_t SNAPSHOT_INTERVAL_NS = 60ull * 1000000000ull;
+constexpr uint64_t SNAPSHOT_RETRY_NS = 1000000000ull;
+
+uint32_t journal_checksum(const JournalRecord& r);
+
+class Journal {
+public:
+    Journal();
+    ~Journal();
+    
+    // Maps dir/journal, creating the directory and file as needed, and
+    // starts the sync thread.
+    bool open(const std::string& dir, size_t capacity = JOURNAL_DEFAULT_CAPACITY);
+    bool is_open() const { return records != nullptr; }
+    // Syncs everything written and unmaps the journal.
+    void close();
+    
+    // Assigns the next lsn and copies r into the ring. When the ring is
+    // full, waits for a snapshot already on its way to disk to make room;
+    // with none coming, the record is dropped and false returned. Its lsn
+    // stays unused, so replay stops there rather than skip a change, and
+    // should_snapshot() asks for a snapshot at once.
+    bool append(JournalRecord& r);
+    
+    // Calls fn(record) for every complete record with lsn > after, in order.
+    // Returns false if the journal starts past after + 1.
+    template <typename Fn>
+    bool replay(uint64_t after, Fn fn) const;
+    
+    // Last lsn handed out; a snapshot taken now covers it.
+    uint64_t last_lsn() const;
+    bool should_snapshot() const;
+    
+    // Hands a snapshot covering everything up to lsn to the flusher thread,
+    // which writes it atomically and then frees the journal records it
+    // covers. Waits for the previous snapshot if that is still being
+    // written. close() finishes a pending one.
+    void queue_snapshot(std::string&& data, uint64_t lsn);
+    bool read_snapshot(std::string& data) const;
+
+private:
+    std::string dir;
+    int fd;
+    JournalHeader* header;
+    JournalRecord* records;
+    size_t map_size;
+    
+    size_t capacity;
+    
+    alignas(64) std::atomic<uint64_t> next;     // lsn the next append gets
+    alignas(64) std::atomic<uint64_t> base;     // header->base_lsn, for appenders
+    uint64_t synced;                            // records below this lsn are on disk
+    std::atomic<bool> full;
+    
+    // Written by the coordinator, then owned by the flusher until
+    // snapshot_pending is cleared again.
+    std::string snapshot_data;
+    uint64_t snapshot_lsn;
+    std::atomic<bool> snapshot_pending;
+    std::atomic<uint64_t> last_snapshot_ns;
+    std::atomic<bool> snapshot_failed;
+    WaitWord snapshot_done;
+    
+    std::mutex sync_mutex;
+    WaitWord wake;
+    std::atomic<bool> stopping;
+    std::thread syncer;
+    
+    void sync_loop();
+    void sync();
+    void sync_records(uint64_t from, uint64_t to);
+    void write_snapshot();
+};
+
+template <typename Fn>
+bool Journal::replay(uint64_t after, Fn fn) const {
+    if (header->base_lsn > after + 1) return false;
+    
+    for (uint64_t lsn = after + 1;; lsn++) {
+        const JournalRecord& r = records[lsn % capacity];
+        if (r.lsn != lsn || r.checksum != journal_checksum(r)) break;
+        fn(r);
+    }
+    return true;
+}
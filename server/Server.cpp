@@ -1,15 +1,108 @@
 #include "Server.hpp"
+#include "../include/RequestRing.hpp"
+#include "../include/ClientIndex.hpp"
+#include "../include/WaitWord.hpp"
+#include "../include/Logger.hpp"
+#include "../include/Dictionary.hpp"
+#include "../include/Signals.hpp"
+#include <algorithm>
 #include <iostream>
-#include <sstream>
+#include <cstddef>
+#include <cstdio>
 #include <cstring>
+#include <csignal>
+#include <mutex>
+#include <stdexcept>
 #include <unistd.h>
 
-Server::Server() : shm(true), root(shm.root()) {
+// While a thread works through a batch of messages, replies only record
+// their slot here and each client is notified once when the batch ends.
+static thread_local bool batching = false;
+static thread_local std::vector<ClientSlot*> deferred_wakeups;
+
+static void begin_batch() {
+    batching = true;
+}
+
+static void end_batch() {
+    batching = false;
+    
+    std::sort(deferred_wakeups.begin(), deferred_wakeups.end());
+    auto last = std::unique(deferred_wakeups.begin(), deferred_wakeups.end());
+    for (auto it = deferred_wakeups.begin(); it != last; ++it) {
+        notify((*it)->ready);
+    }
+    deferred_wakeups.clear();
+}
+
+// Pending finders are matched once the queue is empty, or earlier once this
+// many have piled up under sustained load.
+static constexpr size_t FIND_BATCH_MAX = 32;
+
+// How long a new server waits for the one it replaces to hand over.
+static constexpr uint64_t HANDOFF_TIMEOUT_NS = 10ull * 1000000000ull;
+
+Server::Server(size_t worker_count, const ShmConfig& config, const std::string& journal_dir,
+               const GameTimeouts& timeouts, const char* shm_name)
+    : shm(true, config, shm_name), root(shm.root()), matchmaking(&root->waiting), matches_created(0),
+      worker_backlog(new std::atomic<uint32_t>[root->max_clients]()), worker_drained{}, timeouts(timeouts),
+      timers(monotonic_ns()), game_timers(root->max_games), handoff(false), stopping(false), recovering(false), reaper_wake{},
+      reaper_stopping(false) {
     std::cout << "=== Bulls and Cows Server ===" << std::endl;
-    std::cout << "Server initialized with shared memory" << std::endl;
+    std::cout << "Server " << (shm.adopted() ? "adopted" : "initialized with") << " shared memory ("
+              << root->segment_size << " bytes, " << root->max_clients << " clients, " << root->max_games
+              << " games, " << root->queue_size << " queue entries)" << std::endl;
+    
+    for (size_t i = 0; i < game_timers.size(); i++) {
+        game_timers[i].id = static_cast<int32_t>(i);
+    }
+    
+    // The previous server has to let go of the segment and the journal first.
+    if (shm.adopted()) {
+        take_over();
+    }
+    
+    if (!journal_dir.empty()) {
+        if (!journal.open(journal_dir)) {
+            if (shm.adopted()) shm.release();
+            throw std::runtime_error("Failed to open journal in " + journal_dir);
+        }
+        if (!shm.adopted()) {
+            recover();
+        }
+    }
+    
+    if (shm.adopted()) {
+        adopt();
+    }
+    root->server_pid.store(getpid(), std::memory_order_release);
+    
+    for (size_t i = 0; i < worker_count; i++) {
+        workers.push_back(std::make_unique<GameWorker>(
+            [this](const Message& m, int game_id) {
+                begin_batch();
+                // The client left or timed out after the message was routed;
+                // its old game may not even be on this shard any more.
+                if (client_game_id(m) == game_id) {
+                    handle_message(m);
+                } else {
+                    send_response_to(m, ST_NOT_IN_GAME);
+                }
+                if (worker_backlog[m.slot].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    notify(worker_drained);
+                }
+            },
+            [] { end_batch(); }));
+    }
+    std::cout << "Game workers: " << workers.size() << std::endl;
+    
+    reaper = std::thread(&Server::reap_loop, this);
 }
 
 Server::~Server() {
+    stop_reaper();
+    workers.clear();
+    
     for (auto& pair : games_map) {
         delete pair.second;
     }
@@ -18,69 +111,326 @@ Server::~Server() {
 void Server::run() {
     std::cout << "Server is running. Waiting for messages..." << std::endl;
     
-    while (true) {
-        pthread_mutex_lock(&root->mutex);
+    RequestRing ring(root);
+    
+    while (!handoff.load(std::memory_order_acquire) && !stopping.load(std::memory_order_acquire)) {
+        // Drain everything already published, bounded by one ring's worth so
+        // replies to the first messages are not held back indefinitely.
+        size_t handled = 0;
+        begin_batch();
         
-        while (root->q_head == root->q_tail) {
-            pthread_cond_wait(&root->server_cond, &root->mutex);
+        Message* m;
+        while (handled < root->queue_size && (m = ring.front())) {
+            // MSG_NOP only fills a cell the reaper took back from a dead producer.
+            if (m->type != MSG_NOP) {
+                dispatch(*m);
+            }
+            ring.pop();
+            handled++;
         }
         
-        Message m = root->queue[root->q_head];
-        root->queue[root->q_head].used = false;
-        root->q_head = (root->q_head + 1) % QUEUE_SIZE;
+        if (!handled) {
+            flush_finders();
+        }
+        end_batch();
         
-        pthread_mutex_unlock(&root->mutex);
+        timers.advance(monotonic_ns(), [this](Timer& t) { check_game(t.id); });
         
-        if (m.used) {
-            handle_message(m);
+        if (journal.is_open() && journal.should_snapshot()) {
+            snapshot();
         }
+        
+        if (!handled) {
+            ring.wait(timers.next_timeout_ms(monotonic_ns()));
+        }
+    }
+    
+    if (handoff.load(std::memory_order_acquire)) {
+        hand_off();
     }
 }
 
-ClientSlot* Server::find_or_create_client(const char* login) {
-    for (size_t i = 0; i < MAX_CLIENTS; i++) {
-        if (root->clients[i].used && strcmp(root->clients[i].login, login) == 0) {
-            return &root->clients[i];
+void Server::request_handoff() {
+    handoff.store(true, std::memory_order_release);
+    notify(root->queue.ready);
+}
+
+void Server::request_stop() {
+    stopping.store(true, std::memory_order_release);
+    notify(root->queue.ready);
+}
+
+// Asks the server recorded in the segment to hand it over and waits until
+// it has. A server that is no longer running has nothing to hand over.
+void Server::take_over() {
+    pid_t pid = root->server_pid.load(std::memory_order_acquire);
+    if (pid <= 0 || pid == getpid() || kill(pid, 0) != 0) return;
+    
+    std::cout << "Taking over from server " << pid << "..." << std::endl;
+    kill(pid, SIGUSR2);
+    
+    uint64_t deadline = monotonic_ns() + HANDOFF_TIMEOUT_NS;
+    while (root->server_pid.load(std::memory_order_acquire) != 0 && kill(pid, 0) == 0) {
+        if (monotonic_ns() > deadline) {
+            shm.release();
+            throw std::runtime_error("Previous server did not hand over the segment");
         }
+        usleep(1000);
+    }
+}
+
+// Everything but the Game objects already lives in the segment. Their
+// candidate sets come from the predecessor's final snapshot when it kept a
+// journal; otherwise hints start over from the whole dictionary.
+void Server::adopt() {
+    for (size_t i = 0; i < root->max_games; i++) {
+        GameData* gdata = &root->games()[i];
+        if (!gdata->used) continue;
+        
+        game_object(i);
+        watch_game(i, monotonic_ns());
+        int n;
+        if (sscanf(gdata->game_name, "match-%d", &n) == 1) {
+            matches_created = std::max(matches_created, n);
+        }
+    }
+    
+    std::string data;
+    if (journal.is_open() && journal.read_snapshot(data)) {
+        uint64_t lsn;
+        load_snapshot(data, lsn, true);
+    }
+    
+    std::cout << "Adopted " << root->stats()->active_clients.load() << " clients and "
+              << root->game_count.load() << " games" << std::endl;
+}
+
+// Called instead of shutting down when a new server takes over: pending
+// work is finished, the queue is left as it is for the successor, and the
+// segment is not unlinked.
+void Server::hand_off() {
+    stop_reaper();
+    
+    begin_batch();
+    flush_finders();
+    end_batch();
+    
+    // Workers handle what is left in their inboxes before they exit.
+    workers.clear();
+    
+    if (journal.is_open()) {
+        snapshot();
+        journal.close();
     }
     
-    for (size_t i = 0; i < MAX_CLIENTS; i++) {
-        if (!root->clients[i].used) {
-            root->clients[i].used = true;
-            strncpy(root->clients[i].login, login, LOGIN_MAX - 1);
-            root->clients[i].login[LOGIN_MAX - 1] = '\0';
-            root->clients[i].has_response = false;
-            root->clients[i].current_game_id = -1;
-            return &root->clients[i];
+    shm.release();
+    root->server_pid.store(0, std::memory_order_release);
+    std::cout << "Handed the segment over to the new server" << std::endl;
+}
+
+void Server::dispatch(const Message &m) {
+    bool known = m.slot >= 0 && static_cast<size_t>(m.slot) < root->max_clients;
+    
+    if (!workers.empty() && known &&
+        (m.type == MSG_GUESS || m.type == MSG_BATCH || m.type == MSG_HINT || m.type == MSG_LEAVE_GAME ||
+         m.type == MSG_GAME_STATUS)) {
+        int game_id = client_game_id(m);
+        if (game_id != -1) {
+            worker_backlog[m.slot].fetch_add(1, std::memory_order_relaxed);
+            workers[game_index(game_id) % workers.size()]->post(m, game_id);
+            return;
         }
     }
     
-    return nullptr;
+    if (known) {
+        wait_for_workers(m.slot);
+    }
+    handle_message(m);
+}
+
+// A client's game only changes on the coordinator or on the worker that
+// owns the game, so everything the client has in flight sits on one worker.
+void Server::wait_for_workers(int slot) {
+    std::atomic<uint32_t>& backlog = worker_backlog[slot];
+    while (backlog.load(std::memory_order_acquire) != 0) {
+        uint32_t key = wait_prepare(worker_drained);
+        if (backlog.load(std::memory_order_acquire) == 0) break;
+        wait_until(worker_drained, key);
+    }
+}
+
+ClientSlot* Server::find_or_create_client(const char* login) {
+    ClientSlot* existing = find_client(login);
+    if (existing) return existing;
+    
+    int i = free_list_pop(root->free_clients, root->clients());
+    if (i == -1) return nullptr;
+    
+    ClientSlot* slot = init_client(i, login);
+    journal_append(JR_REGISTER, i, slot->login, nullptr, 0, slot->generation.load(std::memory_order_relaxed));
+    return slot;
+}
+
+ClientSlot* Server::init_client(int i, const char* login) {
+    ClientSlot* slot = &root->clients()[i];
+    shm_lock(&slot->mutex);
+    slot->used.store(true, std::memory_order_relaxed);
+    strncpy(slot->login, login, LOGIN_MAX - 1);
+    slot->login[LOGIN_MAX - 1] = '\0';
+    slot->resp_head.store(0, std::memory_order_relaxed);
+    slot->resp_tail.store(0, std::memory_order_relaxed);
+    slot->current_game_id = -1;
+    slot->events.store(false, std::memory_order_relaxed);
+    slot->pid.store(0, std::memory_order_relaxed);
+    slot->heartbeat_ns.store(monotonic_ns(), std::memory_order_relaxed);
+    slot->generation.fetch_add(1, std::memory_order_release);
+    pthread_mutex_unlock(&slot->mutex);
+    
+    root->stats()->active_clients.fetch_add(1, std::memory_order_relaxed);
+    
+    ClientIndex(root).insert(slot->login, i);
+    return slot;
+}
+
+void Server::release_client(ClientSlot* client) {
+    int i = static_cast<int>(client - root->clients());
+    journal_append(JR_QUIT, i);
+    ClientIndex(root).erase(client->login);
+    
+    shm_lock(&client->mutex);
+    client->used.store(false, std::memory_order_relaxed);
+    client->current_game_id = -1;
+    client->events.store(false, std::memory_order_relaxed);
+    client->generation.fetch_add(1, std::memory_order_release);
+    pthread_mutex_unlock(&client->mutex);
+    
+    notify(client->ready);
+    free_list_push(root->free_clients, root->clients(), i);
+    root->stats()->active_clients.fetch_sub(1, std::memory_order_relaxed);
 }
 
 ClientSlot* Server::find_client(const char* login) {
-    for (size_t i = 0; i < MAX_CLIENTS; i++) {
-        if (root->clients[i].used && strcmp(root->clients[i].login, login) == 0) {
-            return &root->clients[i];
-        }
+    return ClientIndex(root).find(login);
+}
+
+ClientSlot* Server::session(const Message &m) {
+    if (m.slot < 0 || static_cast<size_t>(m.slot) >= root->max_clients) return nullptr;
+    
+    ClientSlot* client = &root->clients()[m.slot];
+    if (!client->used.load(std::memory_order_relaxed) ||
+        client->generation.load(std::memory_order_acquire) != m.token) {
+        return nullptr;
     }
-    return nullptr;
+    return client;
 }
 
-void Server::send_response_to(const char* login, const char* text) {
-    ClientSlot* client = find_client(login);
+int Server::client_game_id(const Message &m) {
+    ClientSlot* client = session(m);
+    if (!client) return -1;
+    
+    shm_lock(&client->mutex);
+    int game_id = client->current_game_id;
+    pthread_mutex_unlock(&client->mutex);
+    
+    return game_id;
+}
+
+void Server::set_client_game_id(const Message &m, int game_id) {
+    ClientSlot* client = session(m);
+    if (!client) return;
+    
+    shm_lock(&client->mutex);
+    client->current_game_id = game_id;
+    pthread_mutex_unlock(&client->mutex);
+}
+
+void Server::send_response_to(const Message &m, Status status, const void* body, size_t size) {
+    ClientSlot* client = m.type == MSG_REGISTER ? find_client(m.from) : session(m);
     if (!client) return;
     
-    pthread_mutex_lock(&root->mutex);
-    strncpy(client->response, text, RESP_MAX - 1);
-    client->response[RESP_MAX - 1] = '\0';
-    client->has_response = true;
-    pthread_cond_signal(&client->cond);
-    pthread_mutex_unlock(&root->mutex);
+    if (!push(client, m.seq, m.type, status, body, size, 0)) {
+        log_event(EV_RESPONSE_RING_FULL, m.from);
+    }
+}
+
+// Appends to the client's response ring unless fewer than spare + 1
+// entries are free.
+bool Server::push(ClientSlot* client, uint32_t seq, uint8_t type, Status status, const void* body, size_t size,
+                  uint32_t spare) {
+    uint64_t start = monotonic_ns();
+    shm_lock(&client->mutex);
+    
+    uint32_t tail = client->resp_tail.load(std::memory_order_relaxed);
+    if (tail - client->resp_head.load(std::memory_order_acquire) >= RESP_RING_SIZE - spare) {
+        pthread_mutex_unlock(&client->mutex);
+        return false;
+    }
+    
+    Response& r = client->responses[tail & (RESP_RING_SIZE - 1)];
+    r.seq = seq;
+    r.slot = static_cast<int32_t>(client - root->clients());
+    r.token = client->generation.load(std::memory_order_relaxed);
+    r.type = type;
+    r.status = status;
+    if (body) {
+        memcpy(&r.body, body, size);
+    }
+    client->resp_tail.store(tail + 1, std::memory_order_release);
+    
+    pthread_mutex_unlock(&client->mutex);
+    
+    if (batching) {
+        deferred_wakeups.push_back(client);
+    } else {
+        notify(client->ready);
+    }
+    
+    root->stats()->of(type)->delivery.record(monotonic_ns() - start);
+    return true;
+}
+
+// Pushes an event to every subscribed player seated in the game but
+// `except`. Called with the game's mutex held; client mutexes are only
+// ever taken after a game's.
+void Server::publish(GameData* gdata, int game_id, EventKind kind, const char* login, int attempts,
+                     const char* except) {
+    GameEvent e = {};
+    e.game_id = game_id;
+    e.kind = kind;
+    e.attempts = attempts;
+    e.player_count = gdata->player_count;
+    e.max_players = gdata->max_players;
+    if (login) strncpy(e.login, login, LOGIN_MAX - 1);
+    
+    for (int i = 0; i < gdata->player_count; i++) {
+        if (except && strcmp(gdata->players[i], except) == 0) continue;
+        
+        ClientSlot* client = find_client(gdata->players[i]);
+        if (client && client->events.load(std::memory_order_relaxed) &&
+            !push(client, 0, MSG_EVENT, ST_OK, &e, sizeof(e), 1)) {
+            log_event(EV_RESPONSE_RING_FULL, gdata->players[i]);
+        }
+    }
+}
+
+// Tells the other players that login solved the word and won.
+void Server::publish_guess(GameData* gdata, int game_id, const char* login, const GuessResult& result) {
+    if (result.flags & GUESS_WINNER) {
+        publish(gdata, game_id, EVENT_GAME_WON, login, result.attempt, login);
+    }
 }
 
 void Server::handle_message(const Message &m) {
-    std::cout << "[MSG] From: " << m.from << ", Type: " << (int)m.type << std::endl;
+    log_event(EV_MESSAGE, m.from, m.type);
+    
+    uint64_t start = monotonic_ns();
+    TypeStats* stats = root->stats()->of(m.type);
+    stats->queue_wait.record(start > m.enqueued_ns ? start - m.enqueued_ns : 0);
+    
+    if (m.type != MSG_REGISTER && !session(m)) {
+        log_event(EV_STALE_SESSION, m.from);
+        return;
+    }
     
     switch (m.type) {
         case MSG_REGISTER:
@@ -101,316 +451,1025 @@ void Server::handle_message(const Message &m) {
         case MSG_GUESS:
             handle_guess(m);
             break;
+        case MSG_BATCH:
+            handle_batch(m);
+            break;
+        case MSG_HINT:
+            handle_hint(m);
+            break;
         case MSG_LEAVE_GAME:
             handle_leave_game(m);
             break;
         case MSG_GAME_STATUS:
             handle_game_status(m);
             break;
+        case MSG_QUIT:
+            handle_quit(m);
+            break;
+        case MSG_REAP:
+            handle_reap(m);
+            break;
+        case MSG_SUBSCRIBE:
+            handle_subscribe(m);
+            break;
         default:
-            send_response_to(m.from, "ERROR: Unknown message type");
+            send_response_to(m, ST_UNKNOWN_TYPE);
     }
+    
+    stats->handler.record(monotonic_ns() - start);
 }
 
 void Server::handle_register(const Message &m) {
-    pthread_mutex_lock(&root->mutex);
     ClientSlot* client = find_or_create_client(m.from);
-    pthread_mutex_unlock(&root->mutex);
     
     if (client) {
-        std::cout << "Client registered: " << m.from << std::endl;
-        send_response_to(m.from, "OK: Registered successfully");
+        client->pid.store(m.pid, std::memory_order_relaxed);
+        client->heartbeat_ns.store(monotonic_ns(), std::memory_order_relaxed);
+        log_event(EV_CLIENT_REGISTERED, m.from);
+        send_response_to(m, ST_OK);
     } else {
-        send_response_to(m.from, "ERROR: Server is full");
+        send_response_to(m, ST_SERVER_FULL);
     }
+    
+    notify(root->registrations);
 }
 
 void Server::handle_list_games(const Message &m) {
-    std::ostringstream oss;
-    oss << "Available games:\n";
-    
-    pthread_mutex_lock(&root->mutex);
-    bool found = false;
-    for (size_t i = 0; i < MAX_GAMES; i++) {
-        if (root->games[i].used) {
-            found = true;
-            oss << "  - " << root->games[i].game_name 
-                << " (" << root->games[i].player_count << "/" << root->games[i].max_players << " players)";
-            
-            if (root->games[i].state == GAME_WAITING) {
-                oss << " [WAITING]";
-            } else if (root->games[i].state == GAME_ACTIVE) {
-                oss << " [ACTIVE]";
-            } else {
-                oss << " [FINISHED]";
-            }
-            oss << "\n";
+    GameList list;
+    list.count = 0;
+    list.next_offset = -1;
+    
+    size_t i = m.body.list.offset > 0 ? m.body.list.offset : 0;
+    for (; i < root->max_games && list.count < static_cast<int32_t>(LIST_PAGE_SIZE); i++) {
+        GameData* gdata = &root->games()[i];
+        shm_lock(&gdata->mutex);
+        
+        if (gdata->used) {
+            GameSummary& g = list.games[list.count++];
+            memcpy(g.game_name, gdata->game_name, LOGIN_MAX);
+            g.state = gdata->state;
+            g.player_count = gdata->player_count;
+            g.max_players = gdata->max_players;
         }
+        
+        pthread_mutex_unlock(&gdata->mutex);
     }
-    pthread_mutex_unlock(&root->mutex);
     
-    if (!found) {
-        oss << "  No games available\n";
+    if (i < root->max_games) {
+        list.next_offset = static_cast<int32_t>(i);
     }
     
-    send_response_to(m.from, oss.str().c_str());
+    send_response_to(m, ST_OK, &list, offsetof(GameList, games) + list.count * sizeof(GameSummary));
 }
 
 int Server::create_game(const std::string& game_name, const std::string& creator, int max_players) {
-    pthread_mutex_lock(&root->mutex);
+    int index = free_list_pop(root->free_games, root->games());
+    if (index == -1) {
+        return -1;
+    }
     
-    int game_id = -1;
-    for (size_t i = 0; i < MAX_GAMES; i++) {
-        if (!root->games[i].used) {
-            game_id = i;
-            break;
-        }
+    int game_id = init_game(index, game_name.c_str(), creator.c_str(), max_players);
+    
+    log_event(EV_GAME_CREATED, game_name.c_str(), game_id);
+    
+    // A one-player game is full, and starts, as soon as it is created.
+    GameData* gdata = &root->games()[index];
+    game_write_lock(gdata);
+    if (start_if_full(game_object(index), gdata, game_id)) {
+        matchmaking.update(root->games(), index);
     }
+    game_write_unlock(gdata);
     
-    if (game_id == -1) {
-        pthread_mutex_unlock(&root->mutex);
-        return -1;
+    return game_id;
+}
+
+// Called with the game's write lock held.
+bool Server::start_if_full(Game* game, GameData* gdata, int game_id) {
+    if (!game->is_full() || !game->can_start()) return false;
+    
+    game->start_game();
+    journal_append(JR_START, game_index(game_id), nullptr, gdata->secret);
+    watch_game(game_index(game_id), monotonic_ns() + timeouts.turn_ns);
+    publish(gdata, game_id, EVENT_GAME_STARTED);
+    log_event(EV_GAME_STARTED, gdata->game_name);
+    return true;
+}
+
+Game* Server::game_object(int index) {
+    std::unique_lock<std::shared_mutex> lock(games_map_mutex);
+    Game*& entry = games_map[index];
+    if (!entry) {
+        entry = new Game(&root->games()[index], root->stats());
     }
+    return entry;
+}
+
+int Server::init_game(int index, const char* game_name, const char* creator, int max_players) {
+    GameData* gdata = &root->games()[index];
+    Game* game = game_object(index);
+    
+    game_write_lock(gdata);
     
-    GameData* gdata = &root->games[game_id];
+    uint32_t generation = gdata->generation.load(std::memory_order_relaxed);
+    int game_id = make_game_id(generation, index);
     gdata->used = true;
-    strncpy(gdata->game_name, game_name.c_str(), LOGIN_MAX - 1);
+    strncpy(gdata->game_name, game_name, LOGIN_MAX - 1);
     gdata->game_name[LOGIN_MAX - 1] = '\0';
     gdata->player_count = 0;
     gdata->max_players = max_players;
     gdata->state = GAME_WAITING;
+    gdata->state_ns = monotonic_ns();
+    root->stats()->games_by_state[GAME_WAITING].fetch_add(1, std::memory_order_relaxed);
     gdata->winner_index = -1;
     gdata->start_time = 0;
     gdata->end_time = 0;
+    game->add_player(creator);
+    matchmaking.update(root->games(), index);
+    journal_append(JR_CREATE, index, gdata->game_name, creator, max_players, generation);
+    watch_game(index, gdata->state_ns + timeouts.lobby_ns);
     
-    Game* game = new Game(gdata);
-    games_map[game_id] = game;
-    
-    root->game_count++;
+    game_write_unlock(gdata);
     
-    pthread_mutex_unlock(&root->mutex);
-    
-    std::cout << "Game created: " << game_name << " (ID: " << game_id << ")" << std::endl;
+    root->game_count.fetch_add(1, std::memory_order_relaxed);
     
     return game_id;
 }
 
 void Server::handle_create_game(const Message &m) {
-    std::istringstream iss(m.payload);
-    std::string game_name;
-    int max_players = 2;
-    
-    iss >> game_name >> max_players;
+    GameRef ref;
+    memcpy(ref.game_name, m.body.create.game_name, LOGIN_MAX);
+    ref.game_name[LOGIN_MAX - 1] = '\0';
+    int max_players = m.body.create.max_players;
     
-    if (game_name.empty()) {
-        send_response_to(m.from, "ERROR: Game name required");
+    if (ref.game_name[0] == '\0') {
+        send_response_to(m, ST_NAME_REQUIRED);
         return;
     }
     
-    if (max_players < 1 || max_players > MAX_CLIENTS) {
-        send_response_to(m.from, "ERROR: Invalid max_players");
+    if (max_players < 1 || max_players > MAX_PLAYERS) {
+        send_response_to(m, ST_INVALID_MAX_PLAYERS);
         return;
     }
     
-    int game_id = create_game(game_name, m.from, max_players);
+    ref.game_id = create_game(ref.game_name, m.from, max_players);
     
-    if (game_id == -1) {
-        send_response_to(m.from, "ERROR: Cannot create game (server full)");
+    if (ref.game_id == -1) {
+        send_response_to(m, ST_GAMES_FULL);
         return;
     }
     
-    Game* game = get_game(game_id);
-    if (game && game->add_player(m.from)) {
-        pthread_mutex_lock(&root->mutex);
-        ClientSlot* client = find_client(m.from);
-        if (client) client->current_game_id = game_id;
-        pthread_mutex_unlock(&root->mutex);
-        
-        std::ostringstream oss;
-        oss << "OK: Game created: " << game_name << " (ID: " << game_id << ")";
-        send_response_to(m.from, oss.str().c_str());
-    }
+    set_client_game_id(m, ref.game_id);
+    send_response_to(m, ST_OK, &ref, sizeof(ref));
 }
 
 Game* Server::get_game(int game_id) {
-    auto it = games_map.find(game_id);
+    if (game_id < 0 || static_cast<size_t>(game_index(game_id)) >= root->max_games) return nullptr;
+    
+    int index = game_index(game_id);
+    uint32_t generation = root->games()[index].generation.load(std::memory_order_acquire);
+    if ((generation & GAME_GENERATION_MASK) != game_generation(game_id)) return nullptr;
+    
+    std::shared_lock<std::shared_mutex> lock(games_map_mutex);
+    auto it = games_map.find(index);
     if (it != games_map.end()) {
         return it->second;
     }
     return nullptr;
 }
 
-void Server::handle_join_game(const Message &m) {
-    std::string game_name = m.payload;
+bool Server::join_game(int game_id, const Message &m, bool announce) {
+    Game* game = get_game(game_id);
+    if (!game) return false;
     
-    pthread_mutex_lock(&root->mutex);
+    GameData* gdata = &root->games()[game_index(game_id)];
+    game_write_lock(gdata);
     
-    int game_id = -1;
-    for (size_t i = 0; i < MAX_GAMES; i++) {
-        if (root->games[i].used && strcmp(root->games[i].game_name, game_name.c_str()) == 0) {
-            game_id = i;
-            break;
+    bool added = gdata->used && game->add_player(m.from);
+    if (added) {
+        journal_append(JR_JOIN, game_index(game_id), m.from);
+        if (announce) {
+            publish(gdata, game_id, EVENT_PLAYER_JOINED, m.from, 0, m.from);
         }
     }
+    if (added) {
+        start_if_full(game, gdata, game_id);
+    }
+    matchmaking.update(root->games(), game_index(game_id));
     
-    pthread_mutex_unlock(&root->mutex);
+    game_write_unlock(gdata);
     
-    if (game_id == -1) {
-        send_response_to(m.from, "ERROR: Game not found");
-        return;
+    if (added) {
+        set_client_game_id(m, game_id);
+    }
+    return added;
+}
+
+void Server::handle_join_game(const Message &m) {
+    int game_id = -1;
+    for (size_t i = 0; i < root->max_games && game_id == -1; i++) {
+        GameData* gdata = &root->games()[i];
+        shm_lock(&gdata->mutex);
+        if (gdata->used && strncmp(gdata->game_name, m.body.join.game_name, LOGIN_MAX - 1) == 0) {
+            game_id = make_game_id(gdata->generation.load(std::memory_order_relaxed), i);
+        }
+        pthread_mutex_unlock(&gdata->mutex);
     }
     
-    Game* game = get_game(game_id);
-    if (!game) {
-        send_response_to(m.from, "ERROR: Game not found");
+    if (game_id == -1 || !get_game(game_id)) {
+        send_response_to(m, ST_GAME_NOT_FOUND);
         return;
     }
     
-    pthread_mutex_lock(&root->mutex);
-    bool added = game->add_player(m.from);
+    if (join_game(game_id, m)) {
+        GameRef ref;
+        ref.game_id = game_id;
+        memcpy(ref.game_name, m.body.join.game_name, LOGIN_MAX);
+        ref.game_name[LOGIN_MAX - 1] = '\0';
+        send_response_to(m, ST_OK, &ref, sizeof(ref));
+    } else {
+        send_response_to(m, ST_CANNOT_JOIN);
+    }
+}
+
+void Server::handle_find_game(const Message &m) {
+    finders.push_back(m);
+    
+    if (finders.size() >= FIND_BATCH_MAX) {
+        flush_finders();
+    }
+}
+
+void Server::flush_finders() {
+    if (finders.empty()) return;
+    
+    std::vector<Message> batch;
+    batch.swap(finders);
     
-    if (added) {
-        ClientSlot* client = find_client(m.from);
-        if (client) client->current_game_id = game_id;
+    std::unordered_map<int, std::vector<const Message*>> unmatched;
+    for (const Message& m : batch) {
+        if (!session(m)) continue;
         
-        if (game->is_full() && game->can_start()) {
-            game->start_game();
-            std::cout << "Game " << game_name << " started!" << std::endl;
+        int max_players = m.body.find.max_players;
+        if (max_players < 0 || max_players > MAX_PLAYERS) {
+            send_response_to(m, ST_INVALID_MAX_PLAYERS);
+            continue;
         }
-        pthread_mutex_unlock(&root->mutex);
         
-        send_response_to(m.from, "OK: Joined game successfully");
-    } else {
-        pthread_mutex_unlock(&root->mutex);
-        send_response_to(m.from, "ERROR: Cannot join game (full or already joined)");
+        GameRef ref;
+        if (join_waiting(m, max_players, ref)) {
+            send_response_to(m, ST_OK, &ref, sizeof(ref));
+            continue;
+        }
+        
+        unmatched[max_players > 0 ? max_players : 2].push_back(&m);
+    }
+    
+    for (auto& bucket : unmatched) {
+        const std::vector<const Message*>& group = bucket.second;
+        for (size_t i = 0; i < group.size(); i += bucket.first) {
+            size_t end = std::min(group.size(), i + bucket.first);
+            start_match(std::vector<const Message*>(group.begin() + i, group.begin() + end), bucket.first);
+        }
     }
 }
 
-void Server::handle_find_game(const Message &m) {
-    pthread_mutex_lock(&root->mutex);
+bool Server::join_waiting(const Message &m, int max_players, GameRef& ref) {
+    std::vector<int> skipped;
+    bool added = false;
     
-    int game_id = -1;
-    for (size_t i = 0; i < MAX_GAMES; i++) {
-        if (root->games[i].used && root->games[i].state == GAME_WAITING && 
-            root->games[i].player_count < root->games[i].max_players) {
-            game_id = i;
-            break;
+    int index;
+    while (!added && (index = matchmaking.pop(root->games(), max_players)) != -1) {
+        GameData* gdata = &root->games()[index];
+        game_write_lock(gdata);
+        
+        int game_id = make_game_id(gdata->generation.load(std::memory_order_relaxed), index);
+        Game* game = get_game(game_id);
+        added = game && gdata->used && gdata->state == GAME_WAITING && game->add_player(m.from);
+        if (added) {
+            journal_append(JR_JOIN, index, m.from);
+            publish(gdata, game_id, EVENT_PLAYER_JOINED, m.from, 0, m.from);
+            start_if_full(game, gdata, game_id);
+            ref.game_id = game_id;
+            memcpy(ref.game_name, gdata->game_name, LOGIN_MAX);
+            matchmaking.update(root->games(), index);
+        } else {
+            skipped.push_back(index);
+        }
+        
+        game_write_unlock(gdata);
+        
+        if (added) {
+            set_client_game_id(m, game_id);
         }
     }
     
-    pthread_mutex_unlock(&root->mutex);
+    // Games this player could not join (e.g. already seated there) go back
+    // into their bucket only after the search, so pop() cannot return them again.
+    for (int i : skipped) {
+        GameData* gdata = &root->games()[i];
+        shm_lock(&gdata->mutex);
+        matchmaking.update(root->games(), i);
+        pthread_mutex_unlock(&gdata->mutex);
+    }
+    
+    return added;
+}
+
+void Server::start_match(const std::vector<const Message*>& players, int max_players) {
+    GameRef ref;
+    snprintf(ref.game_name, LOGIN_MAX, "match-%d", ++matches_created);
     
+    ref.game_id = create_game(ref.game_name, players[0]->from, max_players);
+    if (ref.game_id == -1) {
+        for (const Message* p : players) {
+            send_response_to(*p, ST_NO_GAMES);
+        }
+        return;
+    }
+    
+    set_client_game_id(*players[0], ref.game_id);
+    // Everyone learns the line-up from the reply; only the start is pushed.
+    // A player who could not be seated is told so and is not counted; the
+    // game then waits for the missing seats like any other lobby instead of
+    // starting short-handed.
+    std::vector<bool> seated(players.size(), true);
+    for (size_t i = 1; i < players.size(); i++) {
+        seated[i] = join_game(ref.game_id, *players[i], false);
+    }
+    
+    for (size_t i = 0; i < players.size(); i++) {
+        if (seated[i]) {
+            send_response_to(*players[i], ST_OK, &ref, sizeof(ref));
+        } else {
+            send_response_to(*players[i], ST_CANNOT_JOIN);
+        }
+    }
+}
+
+void Server::handle_guess(const Message &m) {
+    int game_id = client_game_id(m);
     if (game_id == -1) {
-        send_response_to(m.from, "ERROR: No available games found");
+        send_response_to(m, ST_NOT_IN_GAME);
         return;
     }
     
     Game* game = get_game(game_id);
     if (!game) {
-        send_response_to(m.from, "ERROR: Game not found");
+        send_response_to(m, ST_GAME_NOT_FOUND);
         return;
     }
     
-    pthread_mutex_lock(&root->mutex);
-    bool added = game->add_player(m.from);
+    GameData* gdata = &root->games()[game_index(game_id)];
+    game_write_lock(gdata);
+    GuessResult result;
+    Status status = game->make_guess(m.from, m.body.guess.word, result);
+    if (status == ST_OK) {
+        journal_append(JR_GUESS, game_index(game_id), m.from, m.body.guess.word);
+        publish_guess(gdata, game_id, m.from, result);
+    }
+    game_write_unlock(gdata);
     
-    if (added) {
-        ClientSlot* client = find_client(m.from);
-        if (client) client->current_game_id = game_id;
-        
-        if (game->is_full() && game->can_start()) {
-            game->start_game();
-        }
-        pthread_mutex_unlock(&root->mutex);
-        
-        std::ostringstream oss;
-        oss << "OK: Joined game: " << root->games[game_id].game_name;
-        send_response_to(m.from, oss.str().c_str());
-    } else {
-        pthread_mutex_unlock(&root->mutex);
-        send_response_to(m.from, "ERROR: Cannot join game");
+    send_response_to(m, status, status == ST_OK ? &result : nullptr, sizeof(result));
+}
+
+void Server::handle_hint(const Message &m) {
+    int game_id = client_game_id(m);
+    if (game_id == -1) {
+        send_response_to(m, ST_NOT_IN_GAME);
+        return;
+    }
+    
+    Game* game = get_game(game_id);
+    if (!game) {
+        send_response_to(m, ST_GAME_NOT_FOUND);
+        return;
     }
+    
+    GameData* gdata = &root->games()[game_index(game_id)];
+    shm_lock(&gdata->mutex);
+    HintResult hint;
+    Status status = game->get_hint(m.from, hint);
+    pthread_mutex_unlock(&gdata->mutex);
+    
+    send_response_to(m, status, status == ST_OK ? &hint : nullptr, sizeof(hint));
 }
 
-void Server::handle_guess(const Message &m) {
-    pthread_mutex_lock(&root->mutex);
-    ClientSlot* client = find_client(m.from);
+bool Server::leave_game(const Message &m) {
+    int game_id = client_game_id(m);
+    if (game_id == -1) {
+        return false;
+    }
+    
+    set_client_game_id(m, -1);
+    drop_player(game_id, m.from);
+    log_event(EV_PLAYER_LEFT, m.from, game_id);
     
-    if (!client || client->current_game_id == -1) {
-        pthread_mutex_unlock(&root->mutex);
-        send_response_to(m.from, "ERROR: You are not in a game");
+    return true;
+}
+
+// Takes login's seat in the game, recycling the game once nobody is left.
+void Server::drop_player(int game_id, const char* login) {
+    Game* game = get_game(game_id);
+    if (!game) {
+        journal_append(JR_LEAVE, game_index(game_id), login, nullptr, game_id);
         return;
     }
     
-    int game_id = client->current_game_id;
-    pthread_mutex_unlock(&root->mutex);
+    GameData* gdata = &root->games()[game_index(game_id)];
+    game_write_lock(gdata);
+    bool removed = game->remove_player(login);
+    bool emptied = removed && !gdata->used;
+    matchmaking.update(root->games(), game_index(game_id));
+    journal_append(JR_LEAVE, game_index(game_id), login, nullptr, game_id);
+    if (removed && !emptied) {
+        publish(gdata, game_id, EVENT_PLAYER_LEFT, login);
+    }
+    game_write_unlock(gdata);
+    
+    if (emptied) {
+        remove_game(game_id);
+    }
+}
+
+void Server::handle_batch(const Message &m) {
+    int game_id = client_game_id(m);
+    if (game_id == -1) {
+        send_response_to(m, ST_NOT_IN_GAME);
+        return;
+    }
     
     Game* game = get_game(game_id);
     if (!game) {
-        send_response_to(m.from, "ERROR: Game not found");
+        send_response_to(m, ST_GAME_NOT_FOUND);
         return;
     }
     
-    std::string guess = m.payload;
-    std::string result = game->make_guess(m.from, guess);
-    send_response_to(m.from, result.c_str());
+    BatchResult batch;
+    batch.count = std::min<int32_t>(std::max<int32_t>(m.body.batch.count, 0), BATCH_MAX);
+    
+    GameData* gdata = &root->games()[game_index(game_id)];
+    game_write_lock(gdata);
+    for (int i = 0; i < batch.count; i++) {
+        batch.status[i] = game->make_guess(m.from, m.body.batch.guesses[i].word, batch.results[i]);
+        if (batch.status[i] == ST_OK) {
+            journal_append(JR_GUESS, game_index(game_id), m.from, m.body.batch.guesses[i].word);
+            publish_guess(gdata, game_id, m.from, batch.results[i]);
+        }
+    }
+    game_write_unlock(gdata);
+    
+    send_response_to(m, ST_OK, &batch, offsetof(BatchResult, results) + batch.count * sizeof(GuessResult));
 }
 
 void Server::handle_leave_game(const Message &m) {
-    pthread_mutex_lock(&root->mutex);
-    ClientSlot* client = find_client(m.from);
-    
-    if (!client || client->current_game_id == -1) {
-        pthread_mutex_unlock(&root->mutex);
-        send_response_to(m.from, "ERROR: You are not in a game");
+    if (!leave_game(m)) {
+        send_response_to(m, ST_NOT_IN_GAME);
         return;
     }
     
-    int game_id = client->current_game_id;
-    client->current_game_id = -1;
-    pthread_mutex_unlock(&root->mutex);
+    send_response_to(m, ST_OK);
+}
+
+void Server::handle_quit(const Message &m) {
+    leave_game(m);
     
-    Game* game = get_game(game_id);
-    if (game) {
-        game->remove_player(m.from);
-        std::cout << "Player " << m.from << " left game " << game_id << std::endl;
+    ClientSlot* client = session(m);
+    if (client) {
+        release_client(client);
+        log_event(EV_CLIENT_QUIT, m.from);
     }
+}
+
+// A client is dead once its process is gone, or when it stopped sending
+// heartbeats (hung, or registered before a recovery and never came back).
+static bool client_dead(const ClientSlot& client, uint64_t now) {
+    int32_t pid = client.pid.load(std::memory_order_relaxed);
+    if (pid > 0 && kill(pid, 0) == -1 && errno == ESRCH) return true;
     
-    send_response_to(m.from, "OK: Left game");
+    uint64_t beat = client.heartbeat_ns.load(std::memory_order_relaxed);
+    return now > beat && now - beat > CLIENT_TIMEOUT_NS;
 }
 
-void Server::handle_game_status(const Message &m) {
-    pthread_mutex_lock(&root->mutex);
-    ClientSlot* client = find_client(m.from);
+// Checked again here: the client may have registered anew since the
+// reaper looked.
+void Server::handle_reap(const Message &m) {
+    ClientSlot* client = session(m);
+    if (!client || !client_dead(*client, monotonic_ns())) return;
     
-    if (!client || client->current_game_id == -1) {
-        pthread_mutex_unlock(&root->mutex);
-        send_response_to(m.from, "ERROR: You are not in a game");
-        return;
+    leave_game(m);
+    release_client(client);
+    root->stats()->reaped_clients.fetch_add(1, std::memory_order_relaxed);
+    log_event(EV_CLIENT_REAPED, m.from);
+}
+
+void Server::handle_subscribe(const Message &m) {
+    ClientSlot* client = session(m);
+    if (!client) return;
+    
+    client->events.store(true, std::memory_order_relaxed);
+    send_response_to(m, ST_OK);
+}
+
+void Server::reap_loop() {
+    block_server_signals();
+    RequestRing ring(root);
+    
+    while (!reaper_stopping.load()) {
+        uint32_t key = wait_prepare(reaper_wake);
+        uint64_t now = monotonic_ns();
+        
+        if (size_t released = ring.reclaim()) {
+            log_event(EV_CELLS_RECLAIMED, static_cast<int64_t>(released));
+        }
+        
+        for (size_t i = 0; i < root->max_clients; i++) {
+            ClientSlot* client = &root->clients()[i];
+            if (!client->used.load(std::memory_order_relaxed) || !client_dead(*client, now)) continue;
+            
+            // A full queue is left alone; the next round tries again.
+            uint64_t ticket;
+            Message* m = ring.reserve(ticket);
+            if (!m) break;
+            
+            shm_lock(&client->mutex);
+            memcpy(m->from, client->login, LOGIN_MAX);
+            m->token = client->generation.load(std::memory_order_relaxed);
+            pthread_mutex_unlock(&client->mutex);
+            
+            strcpy(m->to, "server");
+            m->pid = getpid();
+            m->seq = 0;
+            m->slot = static_cast<int32_t>(i);
+            m->type = MSG_REAP;
+            ring.commit(ticket);
+        }
+        
+        struct timespec deadline = monotonic_deadline(CLIENT_HEARTBEAT_MS);
+        wait_until(reaper_wake, key, &deadline);
     }
+}
+
+void Server::stop_reaper() {
+    if (!reaper.joinable()) return;
     
-    int game_id = client->current_game_id;
-    pthread_mutex_unlock(&root->mutex);
+    reaper_stopping.store(true);
+    notify(reaper_wake);
+    reaper.join();
+}
+
+void Server::handle_game_status(const Message &m) {
+    int game_id = client_game_id(m);
+    if (game_id == -1) {
+        send_response_to(m, ST_NOT_IN_GAME);
+        return;
+    }
     
     Game* game = get_game(game_id);
     if (!game) {
-        send_response_to(m.from, "ERROR: Game not found");
+        send_response_to(m, ST_GAME_NOT_FOUND);
         return;
     }
     
-    std::string status = game->get_status();
-    send_response_to(m.from, status.c_str());
+    GameData* gdata = &root->games()[game_index(game_id)];
+    shm_lock(&gdata->mutex);
+    GameSnapshot status;
+    game->get_status(status);
+    pthread_mutex_unlock(&gdata->mutex);
+    
+    send_response_to(m, ST_OK, &status, offsetof(GameSnapshot, players) + status.player_count * sizeof(PlayerStatus));
 }
 
+// Game objects stay in games_map for the lifetime of the server so a
+// concurrent get_game() never sees a dangling pointer; only the GameData
+// slot is recycled. Workers get here too, so the game's timer is left
+// armed: check_game() finds the slot unused and lets it lapse, or the
+// coordinator re-arms it when the slot is handed to a new game.
 void Server::remove_game(int game_id) {
-    auto it = games_map.find(game_id);
-    if (it != games_map.end()) {
-        delete it->second;
-        games_map.erase(it);
+    int index = game_index(game_id);
+    GameData* gdata = &root->games()[index];
+    
+    game_write_lock(gdata);
+    gdata->used = false;
+    root->stats()->games_by_state[gdata->state].fetch_sub(1, std::memory_order_relaxed);
+    gdata->generation.fetch_add(1, std::memory_order_release);
+    matchmaking.update(root->games(), index);
+    game_write_unlock(gdata);
+    
+    free_list_push(root->free_games, root->games(), index);
+    root->game_count.fetch_sub(1, std::memory_order_relaxed);
+}
+
+// Timers belong to the coordinator: they are only armed while it handles
+// a lobby operation, recovers or adopts.
+void Server::watch_game(int index, uint64_t deadline_ns) {
+    timers.schedule(game_timers[index], deadline_ns);
+}
+
+// Fires when the next of a game's timeouts may have passed: applies
+// whichever did and arms the timer for the one after. Guesses run on the
+// workers and leave the timer alone, so a player who kept guessing or a
+// game that was won there is only noticed here, and the timer moves on.
+// A won game is therefore recycled at most turn_ns late.
+void Server::check_game(int index) {
+    GameData* gdata = &root->games()[index];
+    Game* game = game_object(index);
+    uint64_t now = monotonic_ns();
+    
+    std::vector<std::string> kicked;
+    bool idle = false;
+    uint64_t next = 0;
+    
+    game_write_lock(gdata);
+    if (!gdata->used) {
+        game_write_unlock(gdata);
+        return;
+    }
+    int game_id = make_game_id(gdata->generation.load(std::memory_order_relaxed), index);
+    
+    if (gdata->state == GAME_WAITING && now >= gdata->state_ns + timeouts.lobby_ns) {
+        log_event(EV_GAME_TIMED_OUT, gdata->game_name, game_id);
+        if (gdata->player_count >= 2) {
+            game->start_game();
+            journal_append(JR_START, index, nullptr, gdata->secret);
+            matchmaking.update(root->games(), index);
+            publish(gdata, game_id, EVENT_GAME_STARTED);
+            log_event(EV_GAME_STARTED, gdata->game_name);
+        } else {
+            kicked.assign(gdata->players, gdata->players + gdata->player_count);
+        }
+    } else if (gdata->state == GAME_ACTIVE && now >= gdata->state_ns + timeouts.game_ns) {
+        game->end_game();
+        journal_append(JR_FINISH, index);
+        publish(gdata, game_id, EVENT_GAME_ENDED);
+        log_event(EV_GAME_TIMED_OUT, gdata->game_name, game_id);
+    }
+    
+    if (gdata->state == GAME_WAITING) {
+        next = gdata->state_ns + timeouts.lobby_ns;
+    } else if (gdata->state == GAME_ACTIVE) {
+        idle = true;
+        next = gdata->state_ns + timeouts.game_ns;
+        for (int i = 0; i < gdata->player_count; i++) {
+            if (gdata->finished[i]) continue;
+            
+            uint64_t due = gdata->last_move_ns[i] + timeouts.turn_ns;
+            if (now >= due) {
+                kicked.push_back(gdata->players[i]);
+            } else {
+                next = std::min(next, due);
+            }
+        }
+    } else {
+        next = gdata->state_ns + timeouts.linger_ns;
+        if (now >= next) {
+            log_event(EV_GAME_RECYCLED, gdata->game_name, game_id);
+            kicked.assign(gdata->players, gdata->players + gdata->player_count);
+        }
+    }
+    game_write_unlock(gdata);
+    
+    // Removing the last player recycles the game; the timer then lapses.
+    watch_game(index, next);
+    for (const std::string& login : kicked) {
+        kick_player(game_id, login.c_str(), idle ? EVENT_TIMED_OUT : EVENT_GAME_CLOSED);
+        if (idle) {
+            log_event(EV_PLAYER_TIMED_OUT, login.c_str(), game_id);
+        }
+    }
+}
+
+// A subscribed client is told why; others find out from the
+// ST_NOT_IN_GAME reply to their next request.
+void Server::kick_player(int game_id, const char* login, EventKind reason) {
+    ClientSlot* client = find_client(login);
+    if (client) {
+        shm_lock(&client->mutex);
+        bool seated = client->current_game_id == game_id;
+        if (seated) {
+            client->current_game_id = -1;
+        }
+        pthread_mutex_unlock(&client->mutex);
+        
+        if (seated && client->events.load(std::memory_order_relaxed)) {
+            GameEvent e = {};
+            e.game_id = game_id;
+            e.kind = reason;
+            strncpy(e.login, login, LOGIN_MAX - 1);
+            push(client, 0, MSG_EVENT, ST_OK, &e, sizeof(e), 1);
+        }
+    }
+    
+    drop_player(game_id, login);
+}
+
+void Server::journal_append(JournalType type, int index, const char* name, const char* text, int32_t value,
+                            uint32_t generation) {
+    if (!journal.is_open() || recovering) return;
+    
+    JournalRecord r = {};
+    r.type = type;
+    r.index = index;
+    r.value = value;
+    r.generation = generation;
+    if (name) strncpy(r.name, name, LOGIN_MAX - 1);
+    if (text) strncpy(r.text, text, LOGIN_MAX - 1);
+    if (!journal.append(r)) {
+        root->stats()->journal_dropped.fetch_add(1, std::memory_order_relaxed);
+        log_event(EV_JOURNAL_FULL);
+    }
+}
+
+// Links every unused item, lowest index on top, after recovery has filled
+// slots directly.
+template <typename T>
+static void rebuild_free_list(FreeList& list, T* items, size_t count) {
+    list.head.store(0, std::memory_order_relaxed);
+    for (size_t i = count; i-- > 0;) {
+        if (!items[i].used) {
+            free_list_push(list, items, static_cast<int>(i));
+        }
+    }
+}
+
+static void set_game_id(ClientSlot* client, int game_id) {
+    if (!client) return;
+    
+    shm_lock(&client->mutex);
+    client->current_game_id = game_id;
+    pthread_mutex_unlock(&client->mutex);
+}
+
+// Runs before the workers start. Journal records are applied in lsn order
+// through the same Game methods that produced them, so the replayed state,
+// candidate sets included, matches what the clients were told.
+void Server::recover() {
+    recovering = true;
+    
+    uint64_t lsn = 0;
+    std::string data;
+    if (journal.read_snapshot(data)) {
+        load_snapshot(data, lsn);
+    }
+    
+    size_t replayed = 0;
+    bool contiguous = journal.replay(lsn, [&](const JournalRecord& r) {
+        apply(r);
+        replayed++;
+    });
+    if (!contiguous) {
+        throw std::runtime_error("Journal does not continue the snapshot");
+    }
+    
+    rebuild_free_list(root->free_clients, root->clients(), root->max_clients);
+    rebuild_free_list(root->free_games, root->games(), root->max_games);
+    recovering = false;
+    
+    // Recovered games get their full time again; nobody could play while
+    // the server was down.
+    uint64_t now = monotonic_ns();
+    for (size_t i = 0; i < root->max_games; i++) {
+        GameData* gdata = &root->games()[i];
+        if (!gdata->used) continue;
+        
+        gdata->state_ns = now;
+        std::fill(gdata->last_move_ns, gdata->last_move_ns + MAX_PLAYERS, now);
+        watch_game(i, now);
+    }
+    
+    std::cout << "Recovered " << root->stats()->active_clients.load() << " clients and " << root->game_count.load()
+              << " games (snapshot at lsn " << lsn << ", " << replayed << " journal records)" << std::endl;
+    
+    // Start the new journal from a snapshot of the recovered state.
+    snapshot();
+}
+
+void Server::load_snapshot(const std::string& data, uint64_t& lsn, bool candidates_only) {
+    const char* p = data.data();
+    const char* end = p + data.size();
+    auto take = [&](void* out, size_t size) {
+        if (static_cast<size_t>(end - p) < size) throw std::runtime_error("Snapshot is truncated");
+        memcpy(out, p, size);
+        p += size;
+    };
+    
+    SnapshotHeader header;
+    take(&header, sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("Snapshot has an unknown format");
+    }
+    if (header.max_games > root->max_games) {
+        throw std::runtime_error("Snapshot needs more game slots than configured");
+    }
+    lsn = header.lsn;
+    bool keep_candidates = header.dictionary_size == Dictionary::shared().size();
+    
+    // An adopted segment is already up to date; only a snapshot of exactly
+    // its state can supply the candidate sets.
+    if (candidates_only && (lsn != journal.last_lsn() || !keep_candidates)) return;
+    
+    for (uint32_t i = 0; i < header.max_games; i++) {
+        uint32_t generation;
+        take(&generation, sizeof(generation));
+        if (candidates_only) continue;
+        root->games()[i].generation.store(generation, std::memory_order_relaxed);
+    }
+    
+    for (uint32_t i = 0; i < header.client_count; i++) {
+        SnapshotClient c;
+        take(&c, sizeof(c));
+        if (candidates_only) continue;
+        if (c.slot < 0 || static_cast<size_t>(c.slot) >= root->max_clients) {
+            throw std::runtime_error("Snapshot needs more client slots than configured");
+        }
+        ClientSlot* client = init_client(c.slot, c.login);
+        client->generation.store(c.generation, std::memory_order_relaxed);
+        client->current_game_id = c.game_id;
+    }
+    
+    std::vector<uint32_t> words;
+    for (uint32_t i = 0; i < header.game_count; i++) {
+        SnapshotGame g;
+        take(&g, sizeof(g));
+        if (g.index < 0 || static_cast<uint32_t>(g.index) >= header.max_games ||
+            g.player_count < 0 || g.player_count > MAX_PLAYERS || g.state > GAME_FINISHED) {
+            throw std::runtime_error("Snapshot is damaged");
+        }
+        
+        GameData* gdata = &root->games()[g.index];
+        Game* game = game_object(g.index);
+        if (candidates_only) {
+            words.resize(g.candidate_words);
+            take(words.data(), words.size() * sizeof(uint32_t));
+            const uint32_t* in = words.data();
+            if (!gdata->used || gdata->player_count != g.player_count) continue;
+            if (!game->load_candidates(in, in + words.size())) throw std::runtime_error("Snapshot is damaged");
+            continue;
+        }
+        gdata->used = true;
+        memcpy(gdata->game_name, g.game_name, LOGIN_MAX);
+        memcpy(gdata->players, g.players, sizeof(gdata->players));
+        gdata->player_count = g.player_count;
+        gdata->max_players = g.max_players;
+        gdata->state = g.state;
+        memcpy(gdata->secret, g.secret, sizeof(gdata->secret));
+        memcpy(gdata->attempts, g.attempts, sizeof(gdata->attempts));
+        memcpy(gdata->finished, g.finished, sizeof(gdata->finished));
+        gdata->winner_index = g.winner_index;
+        gdata->start_time = g.start_time;
+        gdata->end_time = g.end_time;
+        root->stats()->games_by_state[g.state].fetch_add(1, std::memory_order_relaxed);
+        root->game_count.fetch_add(1, std::memory_order_relaxed);
+        matchmaking.update(root->games(), g.index);
+        
+        words.resize(g.candidate_words);
+        take(words.data(), words.size() * sizeof(uint32_t));
+        const uint32_t* in = words.data();
+        if (keep_candidates && !game->load_candidates(in, in + words.size())) {
+            throw std::runtime_error("Snapshot is damaged");
+        }
+    }
+}
+
+void Server::apply(const JournalRecord& r) {
+    switch (r.type) {
+        case JR_REGISTER: {
+            if (r.index < 0 || static_cast<size_t>(r.index) >= root->max_clients) break;
+            ClientSlot* client = init_client(r.index, r.name);
+            client->generation.store(r.generation, std::memory_order_relaxed);
+            break;
+        }
+        case JR_QUIT:
+            if (r.index < 0 || static_cast<size_t>(r.index) >= root->max_clients) break;
+            if (root->clients()[r.index].used) {
+                release_client(&root->clients()[r.index]);
+            }
+            break;
+        case JR_CREATE: {
+            if (r.index < 0 || static_cast<size_t>(r.index) >= root->max_games) break;
+            root->games()[r.index].generation.store(r.generation, std::memory_order_relaxed);
+            int game_id = init_game(r.index, r.name, r.text, r.value);
+            set_game_id(find_client(r.text), game_id);
+            break;
+        }
+        case JR_JOIN:
+        case JR_START:
+        case JR_FINISH:
+        case JR_GUESS: {
+            if (r.index < 0 || static_cast<size_t>(r.index) >= root->max_games) break;
+            GameData* gdata = &root->games()[r.index];
+            Game* game = game_object(r.index);
+            
+            game_write_lock(gdata);
+            if (r.type == JR_JOIN) {
+                game->add_player(r.name);
+            } else if (r.type == JR_START) {
+                game->start_game(r.text);
+            } else if (r.type == JR_FINISH) {
+                game->end_game();
+            } else {
+                GuessResult result;
+                game->make_guess(r.name, r.text, result);
+            }
+            matchmaking.update(root->games(), r.index);
+            game_write_unlock(gdata);
+            
+            if (r.type == JR_JOIN) {
+                set_game_id(find_client(r.name), make_game_id(gdata->generation.load(), r.index));
+            }
+            break;
+        }
+        case JR_LEAVE: {
+            set_game_id(find_client(r.name), -1);
+            
+            Game* game = get_game(r.value);
+            if (!game) break;
+            
+            GameData* gdata = &root->games()[game_index(r.value)];
+            game_write_lock(gdata);
+            bool emptied = game->remove_player(r.name) && !gdata->used;
+            matchmaking.update(root->games(), game_index(r.value));
+            game_write_unlock(gdata);
+            
+            if (emptied) {
+                remove_game(r.value);
+            }
+            break;
+        }
+    }
+}
+
+// Copied by the coordinator between batches with every worker parked, so
+// nothing changes underneath it. Workers resume as soon as the copy is
+// done; the journal's flusher thread writes it out.
+void Server::snapshot() {
+    for (auto& worker : workers) {
+        worker->pause();
+    }
+    
+    std::string data;
+    auto put = [&](const void* in, size_t size) {
+        data.append(static_cast<const char*>(in), size);
+    };
+    
+    SnapshotHeader header = {};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.lsn = journal.last_lsn();
+    header.max_games = root->max_games;
+    header.dictionary_size = static_cast<uint32_t>(Dictionary::shared().size());
+    for (size_t i = 0; i < root->max_clients; i++) {
+        header.client_count += root->clients()[i].used;
+    }
+    for (size_t i = 0; i < root->max_games; i++) {
+        header.game_count += root->games()[i].used;
+    }
+    put(&header, sizeof(header));
+    
+    for (size_t i = 0; i < root->max_games; i++) {
+        uint32_t generation = root->games()[i].generation.load(std::memory_order_relaxed);
+        put(&generation, sizeof(generation));
+    }
+    
+    for (size_t i = 0; i < root->max_clients; i++) {
+        ClientSlot* client = &root->clients()[i];
+        if (!client->used) continue;
+        
+        SnapshotClient c = {};
+        c.slot = static_cast<int32_t>(i);
+        c.generation = client->generation.load(std::memory_order_relaxed);
+        c.game_id = client->current_game_id;
+        memcpy(c.login, client->login, LOGIN_MAX);
+        put(&c, sizeof(c));
+    }
+    
+    std::vector<uint32_t> words;
+    for (size_t i = 0; i < root->max_games; i++) {
+        GameData* gdata = &root->games()[i];
+        if (!gdata->used) continue;
+        
+        words.clear();
+        game_object(i)->save_candidates(words);
+        
+        SnapshotGame g = {};
+        g.index = static_cast<int32_t>(i);
+        memcpy(g.game_name, gdata->game_name, LOGIN_MAX);
+        memcpy(g.players, gdata->players, sizeof(g.players));
+        g.player_count = gdata->player_count;
+        g.max_players = gdata->max_players;
+        g.state = gdata->state;
+        memcpy(g.secret, gdata->secret, sizeof(g.secret));
+        memcpy(g.attempts, gdata->attempts, sizeof(g.attempts));
+        memcpy(g.finished, gdata->finished, sizeof(g.finished));
+        g.winner_index = gdata->winner_index;
+        g.start_time = gdata->start_time;
+        g.end_time = gdata->end_time;
+        g.candidate_words = static_cast<uint32_t>(words.size());
+        put(&g, sizeof(g));
+        put(words.data(), words.size() * sizeof(uint32_t));
+    }
+    
+    for (auto& worker : workers) {
+        worker->resume();
     }
     
-    pthread_mutex_lock(&root->mutex);
-    root->games[game_id].used = false;
-    root->game_count--;
-    pthread_mutex_unlock(&root->mutex);
+    journal.queue_snapshot(std::move(data), header.lsn);
 }
@@ -1,27 +1,103 @@
 #pragma once
 #include "../include/SharedTypes.hpp"
 #include "../include/SharedMemory.hpp"
+#include "../include/MatchQueue.hpp"
 #include "Game.hpp"
+#include "GameWorker.hpp"
+#include "Journal.hpp"
+#include "TimerWheel.hpp"
+#include <memory>
+#include <shared_mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
+
+// Game timeouts. A lobby that has waited lobby_ns starts with the players
+// it has, or closes if that is only one. A player who makes no guess for
+// turn_ns is taken out of the game, and a game still running after game_ns
+// ends without a winner. Finished games stay visible for linger_ns, then
+// their slot is recycled.
+struct GameTimeouts {
+    uint64_t lobby_ns = 300ull * 1000000000ull;
+    uint64_t turn_ns = 120ull * 1000000000ull;
+    uint64_t game_ns = 1800ull * 1000000000ull;
+    uint64_t linger_ns = 30ull * 1000000000ull;
+};
 
 class Server {
 public:
-    Server();
+    // With a journal_dir, state is recovered from it at startup and every
+    // change is journaled there. Tests pass their own timeouts and segment
+    // name.
+    explicit Server(size_t worker_count = 0, const ShmConfig& config = ShmConfig(),
+                    const std::string& journal_dir = "", const GameTimeouts& timeouts = GameTimeouts(),
+                    const char* shm_name = SHM_NAME);
     ~Server();
+    // Returns after request_stop(), or after request_handoff() once the
+    // segment is handed over.
     void run();
+    
+    // Safe to call from a signal handler.
+    void request_handoff();
+    void request_stop();
 
 private:
     SharedMemory shm;
     SharedMemoryRoot* root;
     
     std::unordered_map<int, Game*> games_map;
+    std::shared_mutex games_map_mutex;
+    
+    // MSG_FIND_GAME requests are collected here by the coordinator and matched
+    // as a batch whenever the request queue runs dry.
+    MatchQueue matchmaking;
+    std::vector<Message> finders;
+    int matches_created;
+    
+    // In-game messages are sharded by game id across these workers; the
+    // thread running run() acts as coordinator for lobby operations.
+    // worker_backlog counts, per client slot, the messages posted to a worker
+    // and not yet handled. The coordinator waits for a client's count to
+    // drain before it handles anything else from that client, so requests a
+    // client pipelines still run in the order it sent them.
+    std::unique_ptr<std::atomic<uint32_t>[]> worker_backlog;
+    WaitWord worker_drained;
+    std::vector<std::unique_ptr<GameWorker>> workers;
+    
+    // One timer per game slot, driven by the coordinator's wait loop and
+    // only ever touched by the coordinator; see check_game().
+    GameTimeouts timeouts;
+    TimerWheel timers;
+    std::vector<Timer> game_timers;
+    
+    std::atomic<bool> handoff;
+    std::atomic<bool> stopping;
+    Journal journal;
+    bool recovering;
     
+    // Posts MSG_REAP for clients that died without quitting.
+    std::thread reaper;
+    WaitWord reaper_wake;
+    std::atomic<bool> reaper_stopping;
+    
+    void dispatch(const Message &m);
+    void wait_for_workers(int slot);
     void handle_message(const Message &m);
-    void send_response_to(const char* login, const char* text);
+    void send_response_to(const Message &m, Status status, const void* body = nullptr, size_t size = 0);
+    bool push(ClientSlot* client, uint32_t seq, uint8_t type, Status status, const void* body, size_t size,
+              uint32_t spare);
+    void publish(GameData* gdata, int game_id, EventKind kind, const char* login = nullptr, int attempts = 0,
+                 const char* except = nullptr);
+    void publish_guess(GameData* gdata, int game_id, const char* login, const GuessResult& result);
     
     ClientSlot* find_or_create_client(const char* login);
+    ClientSlot* init_client(int i, const char* login);
     ClientSlot* find_client(const char* login);
+    void release_client(ClientSlot* client);
+    ClientSlot* session(const Message &m);
+    int client_game_id(const Message &m);
+    void set_client_game_id(const Message &m, int game_id);
     
     void handle_register(const Message &m);
     void handle_list_games(const Message &m);
@@ -29,10 +105,43 @@ private:
     void handle_join_game(const Message &m);
     void handle_find_game(const Message &m);
     void handle_guess(const Message &m);
+    void handle_batch(const Message &m);
+    void handle_hint(const Message &m);
     void handle_leave_game(const Message &m);
     void handle_game_status(const Message &m);
+    void handle_quit(const Message &m);
+    void handle_reap(const Message &m);
+    void handle_subscribe(const Message &m);
     
     int create_game(const std::string& game_name, const std::string& creator, int max_players);
+    int init_game(int index, const char* game_name, const char* creator, int max_players);
+    Game* game_object(int index);
     Game* get_game(int game_id);
+    bool join_game(int game_id, const Message &m, bool announce = true);
+    bool leave_game(const Message &m);
+    void drop_player(int game_id, const char* login);
+    
+    void flush_finders();
+    bool join_waiting(const Message &m, int max_players, GameRef& ref);
+    bool start_if_full(Game* game, GameData* gdata, int game_id);
+    void start_match(const std::vector<const Message*>& players, int max_players);
     void remove_game(int game_id);
+    
+    void watch_game(int index, uint64_t deadline_ns);
+    void check_game(int index);
+    void kick_player(int game_id, const char* login, EventKind reason);
+    
+    void journal_append(JournalType type, int index, const char* name = nullptr, const char* text = nullptr,
+                        int32_t value = 0, uint32_t generation = 0);
+    void recover();
+    void load_snapshot(const std::string& data, uint64_t& lsn, bool candidates_only = false);
+    void apply(const JournalRecord& r);
+    void snapshot();
+    
+    void take_over();
+    void adopt();
+    void hand_off();
+    
+    void reap_loop();
+    void stop_reaper();
 };
@@ -0,0 +1,85 @@
+#include "TimerWheel.hpp"
+#include <algorithm>
+
+TimerWheel::TimerWheel(uint64_t now_ns) : current(to_ticks(now_ns)), count(0) {
+    for (auto& level : slots) {
+        for (Timer& head : level) {
+            head.prev = head.next = &head;
+        }
+    }
+}
+
+void TimerWheel::schedule(Timer& t, uint64_t deadline_ns) {
+    if (t.armed()) {
+        cancel(t);
+    }
+    t.expires = std::max(to_ticks(deadline_ns), current + 1);
+    insert(t);
+    count++;
+}
+
+void TimerWheel::cancel(Timer& t) {
+    if (!t.armed()) return;
+    
+    t.prev->next = t.next;
+    t.next->prev = t.prev;
+    t.prev = t.next = nullptr;
+    count--;
+}
+
+// Level L holds deadlines TIMER_SLOTS^L or more ticks away, in the slot its
+// wheel reaches no later than the deadline. Deadlines past the top level
+// wait in its furthest slot and are placed again when it comes due. A
+// cascade can bring a timer due on the current tick; it goes into the
+// level 0 slot about to be fired.
+void TimerWheel::insert(Timer& t) {
+    uint64_t expires = t.expires;
+    uint64_t delta = expires - current;
+    
+    int level = 0;
+    while (level < TIMER_LEVELS - 1 && delta >> (TIMER_SLOT_BITS * (level + 1))) {
+        level++;
+    }
+    if (delta >> (TIMER_SLOT_BITS * TIMER_LEVELS)) {
+        expires = current + (1ull << (TIMER_SLOT_BITS * TIMER_LEVELS)) - 1;
+    }
+    
+    Timer& head = slots[level][(expires >> (TIMER_SLOT_BITS * level)) & (TIMER_SLOTS - 1)];
+    t.prev = head.prev;
+    t.next = &head;
+    head.prev->next = &t;
+    head.prev = &t;
+}
+
+void TimerWheel::cascade(int level) {
+    Timer& head = slots[level][(current >> (TIMER_SLOT_BITS * level)) & (TIMER_SLOTS - 1)];
+    while (Timer* t = pop(head)) {
+        insert(*t);
+        count++;
+    }
+}
+
+Timer* TimerWheel::pop(Timer& head) {
+    if (head.next == &head) return nullptr;
+    
+    Timer* t = head.next;
+    cancel(*t);
+    return t;
+}
+
+// Only level 0 is searched; anything further away is at least as far as
+// the next cascade, which is as long as the wait gets.
+int TimerWheel::next_timeout_ms(uint64_t now_ns) const {
+    if (count == 0) return -1;
+    
+    uint64_t tick = current + 1;
+    while (tick & (TIMER_SLOTS - 1)) {
+        const Timer& head = slots[0][tick & (TIMER_SLOTS - 1)];
+        if (head.next != &head) break;
+        tick++;
+    }
+    
+    uint64_t at_ns = tick * TIMER_TICK_MS * 1000000ull;
+    if (at_ns <= now_ns) return 0;
+    return static_cast<int>((at_ns - now_ns + 999999) / 1000000);
+}
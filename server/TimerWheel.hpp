@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Hierarchical timer wheel for the coordinator thread: TIMER_LEVELS wheels
+// of TIMER_SLOTS slots, each level's slot spanning a whole turn of the
+// level below. A timer sits in the lowest level whose range covers its
+// deadline and moves down a level whenever the wheel above reaches its
+// slot. Timers are intrusive list nodes, so scheduling and cancelling are
+// O(1) and nothing is allocated. Not thread-safe.
+
+constexpr int TIMER_TICK_MS = 100;
+constexpr int TIMER_SLOT_BITS = 6;
+constexpr int TIMER_SLOTS = 1 << TIMER_SLOT_BITS;
+constexpr int TIMER_LEVELS = 4;     // 100 ms .. ~19 days
+
+struct Timer {
+    Timer* prev = nullptr;
+    Timer* next = nullptr;
+    uint64_t expires = 0;   // in ticks
+    int32_t id = -1;        // chosen by the owner
+    
+    bool armed() const { return prev != nullptr; }
+};
+
+class TimerWheel {
+public:
+    explicit TimerWheel(uint64_t now_ns);
+    
+    // Arms t for deadline_ns (CLOCK_MONOTONIC), moving it if already armed.
+    // A deadline in the past fires on the next tick.
+    void schedule(Timer& t, uint64_t deadline_ns);
+    void cancel(Timer& t);
+    
+    // Fires every timer due by now_ns through fn(Timer&), in tick order.
+    // fn may schedule or cancel any timer, including the one it was given.
+    template <typename Fn>
+    void advance(uint64_t now_ns, Fn fn);
+    
+    // Milliseconds until advance() can next have something to do, or -1
+    // when no timer is armed.
+    int next_timeout_ms(uint64_t now_ns) const;
+    
+    size_t size() const { return count; }
+
+private:
+    Timer slots[TIMER_LEVELS][TIMER_SLOTS];     // list heads
+    uint64_t current;                           // last tick processed
+    size_t count;
+    
+    static uint64_t to_ticks(uint64_t ns) { return ns / (TIMER_TICK_MS * 1000000ull); }
+    
+    void insert(Timer& t);
+    void cascade(int level);
+    Timer* pop(Timer& head);
+};
+
+template <typename Fn>
+void TimerWheel::advance(uint64_t now_ns, Fn fn) {
+    uint64_t now = to_ticks(now_ns);
+    
+    while (current < now) {
+        // An empty wheel skips ahead instead of ticking through idle time.
+        if (count == 0) {
+            current = now;
+            break;
+        }
+        current++;
+        
+        // Refill the lower levels first: a level's slot comes due each time
+        // the levels below it complete a turn.
+        for (int level = 1; level < TIMER_LEVELS; level++) {
+            if (current & ((1ull << (TIMER_SLOT_BITS * level)) - 1)) break;
+            cascade(level);
+        }
+        
+        Timer& head = slots[0][current & (TIMER_SLOTS - 1)];
+        while (Timer* t = pop(head)) {
+            fn(*t);
+        }
+    }
+}
@@ -1,33 +1,96 @@
 #include "Server.hpp"
+#include "../include/Dictionary.hpp"
+#include "../include/Logger.hpp"
+#include <atomic>
 #include <iostream>
 #include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
 
-Server* server_instance = nullptr;
+// The handlers only raise flags and wake the coordinator; main() tears the
+// server down once run() returns. A signal that arrives before the server
+// exists is picked up right after it is constructed.
+std::atomic<Server*> server_instance{nullptr};
+std::atomic<bool> stop_requested{false};
+std::atomic<bool> handoff_requested{false};
 
-void signal_handler(int signum) {
-    std::cout << "\nShutting down server..." << std::endl;
-    if (server_instance) {
-        delete server_instance;
-        server_instance = nullptr;
+// SIGUSR2 comes from a new server started with --adopt: hand the segment
+// over to it and exit without unlinking it.
+void handoff_handler(int) {
+    handoff_requested.store(true);
+    if (Server* server = server_instance.load()) {
+        server->request_handoff();
     }
-    exit(0);
 }
 
-int main() {
+void signal_handler(int) {
+    stop_requested.store(true);
+    if (Server* server = server_instance.load()) {
+        server->request_stop();
+    }
+}
+
+int main(int argc, char** argv) {
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    signal(SIGUSR2, handoff_handler);
+    
+    ShmConfig config;
+    if (argc > 1 && strcmp(argv[1], "--adopt") == 0) {
+        config.adopt = true;
+        argv++;
+        argc--;
+    }
+    
+    size_t workers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : std::thread::hardware_concurrency();
+    
+    if (argc > 2) config.max_clients = std::strtoul(argv[2], nullptr, 10);
+    if (argc > 3) config.max_games = std::strtoul(argv[3], nullptr, 10);
+    if (argc > 4) config.queue_size = std::strtoul(argv[4], nullptr, 10);
+    
+    const char* dictionary = argc > 5 ? argv[5] : DEFAULT_DICTIONARY_PATH;
+    if (Dictionary::shared().load(dictionary)) {
+        std::cout << "Dictionary: " << Dictionary::shared().size() << " words from " << dictionary << std::endl;
+    } else {
+        std::cout << "Dictionary: using the built-in " << Dictionary::shared().size() << " words" << std::endl;
+    }
+    
+    // Records go to stdout as text, or to the binary log file if one is given.
+    LogLevel level = LOG_INFO;
+    const char* level_name = std::getenv("BC_LOG_LEVEL");
+    if (level_name && !parse_log_level(level_name, level)) {
+        std::cerr << "Unknown BC_LOG_LEVEL " << level_name << ", using info" << std::endl;
+    }
+    const char* log_file = argc > 6 && strcmp(argv[6], "-") != 0 ? argv[6] : nullptr;
+    const char* journal_dir = argc > 7 ? argv[7] : "";
+    if (!Logger::shared().start(level, log_file)) {
+        std::cerr << "Cannot open log file " << log_file << std::endl;
+        return 1;
+    }
     
+    Server* server = nullptr;
     try {
-        server_instance = new Server();
-        server_instance->run();
-        delete server_instance;
+        server = new Server(workers, config, journal_dir);
+        server_instance.store(server);
+        if (stop_requested.load()) server->request_stop();
+        if (handoff_requested.load()) server->request_handoff();
+        
+        server->run();
+        server_instance.store(nullptr);
+        if (stop_requested.load()) {
+            std::cout << "\nShutting down server..." << std::endl;
+        }
+        delete server;
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
-        if (server_instance) {
-            delete server_instance;
-        }
+        server_instance.store(nullptr);
+        delete server;
+        Logger::shared().stop();
         return 1;
     }
     
+    Logger::shared().stop();
+    
     return 0;
 }
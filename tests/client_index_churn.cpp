@@ -0,0 +1,88 @@
+#include "../include/ClientIndex.hpp"
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Registers and erases random logins in a ClientIndex filled to the server's
+// load factor (one entry in two), and checks that a miss still stops after
+// a short probe: erased entries must not pile up as tombstones.
+
+namespace {
+
+constexpr size_t SLOTS = 512;
+constexpr size_t CAPACITY = 2 * SLOTS;
+constexpr int ROUNDS = 200000;
+constexpr size_t MAX_MISS_PROBE = 64;
+
+// Entries a miss for a login hashing to `start` scans before it stops.
+size_t miss_probe(const ClientIndexEntry* entries, size_t start) {
+    size_t n = 0;
+    for (size_t i = start; n < CAPACITY && entries[i].hash.load() != INDEX_EMPTY; i = (i + 1) & (CAPACITY - 1)) {
+        n++;
+    }
+    return n;
+}
+
+}
+
+int main() {
+    std::unique_ptr<ClientSlot[]> slots(new ClientSlot[SLOTS]());
+    std::unique_ptr<ClientIndexEntry[]> entries(new ClientIndexEntry[CAPACITY]());
+    std::atomic<uint32_t> moves{0};
+    ClientIndex index(entries.get(), CAPACITY, slots.get(), &moves);
+    
+    std::mt19937 rng(12345);
+    std::vector<int> live, free_slots;
+    for (size_t i = 0; i < SLOTS; i++) {
+        free_slots.push_back(static_cast<int>(i));
+    }
+    
+    size_t worst = 0;
+    for (int round = 0; round < ROUNDS; round++) {
+        // Hover around a full table so nearly every step erases and inserts.
+        if (!free_slots.empty() && (live.size() < SLOTS / 2 || rng() % 2)) {
+            int i = free_slots.back();
+            free_slots.pop_back();
+            slots[i].used = true;
+            snprintf(slots[i].login, LOGIN_MAX, "churn%d", round);
+            if (!index.insert(slots[i].login, i) || index.find(slots[i].login) != &slots[i]) {
+                printf("FAIL: %s not found after insert\n", slots[i].login);
+                return 1;
+            }
+            live.push_back(i);
+        } else {
+            size_t k = rng() % live.size();
+            int i = live[k];
+            live[k] = live.back();
+            live.pop_back();
+            index.erase(slots[i].login);
+            if (index.find(slots[i].login)) {
+                printf("FAIL: %s found after erase\n", slots[i].login);
+                return 1;
+            }
+            slots[i].used = false;
+            free_slots.push_back(i);
+        }
+        
+        if (round % 1000 == 0) {
+            for (size_t start = 0; start < CAPACITY; start++) {
+                worst = std::max(worst, miss_probe(entries.get(), start));
+            }
+        }
+    }
+    
+    for (int i : live) {
+        if (index.find(slots[i].login) != &slots[i]) {
+            printf("FAIL: %s lost\n", slots[i].login);
+            return 1;
+        }
+    }
+    
+    printf("longest miss probe: %zu of %zu entries\n", worst, CAPACITY);
+    if (worst > MAX_MISS_PROBE) {
+        printf("FAIL: misses scan more than %zu entries\n", MAX_MISS_PROBE);
+        return 1;
+    }
+    return 0;
+}
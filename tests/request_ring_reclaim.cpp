@@ -0,0 +1,97 @@
+#include "../include/SharedMemory.hpp"
+#include "../include/RequestRing.hpp"
+#include <csignal>
+#include <cstdio>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// A producer killed between reserve() and commit() must not stall the
+// consumer: reclaim() publishes its cell as MSG_NOP. Cells of live
+// producers are left alone, and a cell nobody claimed is only taken on the
+// second call that finds it stuck.
+
+namespace {
+
+constexpr const char* TEST_SHM_NAME = "/bulls_cows_test_ring";
+
+bool fail(const char* what) {
+    fprintf(stderr, "FAIL: %s\n", what);
+    return false;
+}
+
+// Reserves a cell in a child process that is then SIGKILLed.
+bool reserve_and_die(SharedMemoryRoot* root) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        RequestRing ring(root);
+        uint64_t ticket;
+        if (!ring.reserve(ticket)) _exit(1);
+        raise(SIGKILL);
+    }
+    
+    int status;
+    return pid > 0 && waitpid(pid, &status, 0) == pid && WIFSIGNALED(status);
+}
+
+bool publish(RequestRing& ring, uint32_t seq) {
+    uint64_t ticket;
+    Message* m = ring.reserve(ticket);
+    if (!m) return false;
+    m->seq = seq;
+    m->type = MSG_GUESS;
+    ring.commit(ticket);
+    return true;
+}
+
+bool pop_expect(RequestRing& ring, uint8_t type, uint32_t seq) {
+    Message* m = ring.front();
+    if (!m || m->type != type || (type != MSG_NOP && m->seq != seq)) return false;
+    ring.pop();
+    return true;
+}
+
+bool run(SharedMemoryRoot* root) {
+    RequestRing ring(root);
+    
+    // Dead owner: published on the first call.
+    if (!reserve_and_die(root)) return fail("child did not die holding a cell");
+    if (!publish(ring, 1)) return fail("reserve after the dead producer");
+    if (ring.front()) return fail("consumer got past the unpublished cell");
+    if (ring.reclaim() != 1) return fail("dead producer's cell not reclaimed");
+    if (!pop_expect(ring, MSG_NOP, 0)) return fail("reclaimed cell is not a MSG_NOP");
+    if (!pop_expect(ring, MSG_GUESS, 1)) return fail("message behind the reclaimed cell lost");
+    
+    // Live owner: never taken, however long it holds the cell.
+    uint64_t ticket;
+    Message* m = ring.reserve(ticket);
+    if (!m) return fail("reserve for the live producer");
+    if (ring.reclaim() != 0 || ring.reclaim() != 0) return fail("live producer's cell reclaimed");
+    m->seq = 2;
+    m->type = MSG_GUESS;
+    ring.commit(ticket);
+    if (!pop_expect(ring, MSG_GUESS, 2)) return fail("live producer's message lost");
+    
+    // No owner recorded: the producer died right after winning the ticket.
+    root->queue.tail.fetch_add(1);
+    if (ring.reclaim() != 0) return fail("unclaimed cell taken without a grace period");
+    if (ring.reclaim() != 1) return fail("stuck unclaimed cell not reclaimed");
+    if (!pop_expect(ring, MSG_NOP, 0)) return fail("unclaimed cell is not a MSG_NOP");
+    
+    // The ring keeps working once every cell has gone through a reclaim.
+    for (uint32_t i = 0; i < 2 * root->queue_size; i++) {
+        if (!publish(ring, i) || !pop_expect(ring, MSG_GUESS, i)) return fail("ring broken after reclaims");
+    }
+    return true;
+}
+
+}
+
+int main() {
+    ShmConfig config;
+    config.max_clients = 1;
+    config.max_games = 1;
+    config.queue_size = 4;
+    SharedMemory shm(true, config, TEST_SHM_NAME);
+    
+    return run(shm.root()) ? 0 : 1;
+}
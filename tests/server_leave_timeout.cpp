@@ -0,0 +1,118 @@
+#include "../server/Server.hpp"
+#include "../benchmarks/Session.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Players leave games on the workers while the coordinator's timers kick
+// idle ones out of theirs, so games are recycled from both sides at once.
+// Only the coordinator may touch the timer wheel. Build with
+// -DCMAKE_CXX_FLAGS=-fsanitize=thread to have TSan check that it does.
+
+namespace {
+
+constexpr const char* TEST_SHM_NAME = "/bulls_cows_test_server";
+constexpr size_t WORKERS = 4;
+constexpr size_t PLAYERS = 8;
+constexpr int ROUNDS = 20;
+
+GameTimeouts short_timeouts() {
+    GameTimeouts t;
+    t.lobby_ns = 50ull * 1000000ull;
+    t.turn_ns = 30ull * 1000000ull;
+    t.game_ns = 2000ull * 1000000ull;
+    t.linger_ns = 20ull * 1000000ull;
+    return t;
+}
+
+class Player {
+public:
+    Player(SharedMemoryRoot* root, size_t id) : session(root, "player" + std::to_string(id)) {}
+    
+    bool register_player() { return session.register_login(); }
+    
+    // Gets into a game and out of it again: a leaver sends MSG_LEAVE_GAME
+    // once the game has started, anyone else waits to be timed out.
+    bool play_round(bool leaver);
+    void quit() { session.quit(); }
+
+private:
+    Session session;
+};
+
+bool Player::play_round(bool leaver) {
+    RequestBody body;
+    body.find.max_players = 2;
+    Response r;
+    if (!session.call(MSG_FIND_GAME, &body, r) || r.status != ST_OK) return false;
+    
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(SESSION_TIMEOUT_MS);
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (!session.call(MSG_GAME_STATUS, nullptr, r)) return false;
+        if (r.status == ST_NOT_IN_GAME) return true;
+        if (r.status != ST_OK) return false;
+        
+        if (leaver && r.body.status.state != GAME_WAITING) {
+            return session.call(MSG_LEAVE_GAME, nullptr, r) && (r.status == ST_OK || r.status == ST_NOT_IN_GAME);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    return false;
+}
+
+bool fail(const char* what) {
+    fprintf(stderr, "FAIL: %s\n", what);
+    return false;
+}
+
+bool run(Server& server, SharedMemoryRoot* root) {
+    std::thread coordinator(&Server::run, &server);
+    
+    std::atomic<size_t> failures{0};
+    std::vector<std::thread> threads;
+    for (size_t id = 0; id < PLAYERS; id++) {
+        threads.emplace_back([&, id] {
+            Player player(root, id);
+            if (!player.register_player()) {
+                failures++;
+                return;
+            }
+            for (int round = 0; round < ROUNDS; round++) {
+                if (!player.play_round((id + round) % 3 != 0)) failures++;
+            }
+            player.quit();
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    
+    // Whatever is still seated times out shortly.
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(SESSION_TIMEOUT_MS);
+    while (root->game_count.load() != 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    
+    server.request_stop();
+    coordinator.join();
+    
+    if (failures.load() != 0) return fail("a player did not get in and out of its games");
+    if (root->game_count.load() != 0) return fail("games left behind after every player quit");
+    return true;
+}
+
+}
+
+int main() {
+    ShmConfig config;
+    config.max_clients = PLAYERS;
+    config.max_games = PLAYERS;
+    config.queue_size = 64;
+    Server server(WORKERS, config, "", short_timeouts(), TEST_SHM_NAME);
+    
+    SharedMemory shm(false, ShmConfig(), TEST_SHM_NAME);
+    return run(server, shm.root()) ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+#include "../server/Server.hpp"
+#include "../benchmarks/Session.hpp"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+// A client may pipeline requests. MSG_LEAVE_GAME for a running game goes to
+// a worker while MSG_CREATE_GAME runs on the coordinator, yet the two must
+// still take effect in the order sent: the player ends up seated in the new
+// game, not taken out of it by the late leave.
+
+namespace {
+
+constexpr const char* TEST_SHM_NAME = "/bulls_cows_test_order";
+constexpr size_t WORKERS = 4;
+constexpr int ROUNDS = 200;
+
+bool fail(int round, const char* what) {
+    fprintf(stderr, "FAIL: round %d: %s\n", round, what);
+    return false;
+}
+
+bool find_game(Session& session) {
+    RequestBody body;
+    body.find.max_players = 2;
+    Response r;
+    return session.call(MSG_FIND_GAME, &body, r) && r.status == ST_OK;
+}
+
+// Both players are matched into a started game; a leaves and creates a
+// game of its own in one go, then b leaves too.
+bool play_round(Session& a, Session& b, int round) {
+    std::thread finder([&] { find_game(b); });
+    bool found = find_game(a);
+    finder.join();
+    if (!found) return fail(round, "no match");
+    
+    RequestBody body;
+    snprintf(body.create.game_name, LOGIN_MAX, "order-%d", round);
+    body.create.max_players = 2;
+    a.send(MSG_LEAVE_GAME);
+    uint32_t created = a.send(MSG_CREATE_GAME, &body);
+    
+    Response r;
+    if (!a.receive(created, r) || r.status != ST_OK) return fail(round, "create after leave failed");
+    if (!a.call(MSG_GAME_STATUS, nullptr, r) || r.status != ST_OK) return fail(round, "not seated in the new game");
+    if (strcmp(r.body.status.game_name, body.create.game_name) != 0) return fail(round, "seated in the wrong game");
+    
+    return a.call(MSG_LEAVE_GAME, nullptr, r) && b.call(MSG_LEAVE_GAME, nullptr, r);
+}
+
+}
+
+int main() {
+    ShmConfig config;
+    config.max_clients = 2;
+    config.max_games = 4;
+    config.queue_size = 64;
+    Server server(WORKERS, config, "", GameTimeouts(), TEST_SHM_NAME);
+    std::thread coordinator(&Server::run, &server);
+    
+    SharedMemory shm(false, ShmConfig(), TEST_SHM_NAME);
+    Session a(shm.root(), "alice");
+    Session b(shm.root(), "bob");
+    
+    bool ok = a.register_login() && b.register_login();
+    for (int round = 0; ok && round < ROUNDS; round++) {
+        ok = play_round(a, b, round);
+    }
+    
+    server.request_stop();
+    coordinator.join();
+    return ok ? 0 : 1;
+}
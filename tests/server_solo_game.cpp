@@ -0,0 +1,59 @@
+#include "../server/Server.hpp"
+#include "../benchmarks/Session.hpp"
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+// A one-player game is full as soon as its creator is seated, so it must
+// start right away, whether it was created by name or formed by
+// MSG_FIND_GAME, instead of waiting out the lobby timeout.
+
+namespace {
+
+constexpr const char* TEST_SHM_NAME = "/bulls_cows_test_solo";
+
+bool fail(const char* what) {
+    fprintf(stderr, "FAIL: %s\n", what);
+    return false;
+}
+
+bool expect_active(Session& session, const char* how) {
+    Response r;
+    if (!session.call(MSG_GAME_STATUS, nullptr, r) || r.status != ST_OK) return fail(how);
+    if (r.body.status.state != GAME_ACTIVE) return fail(how);
+    return session.call(MSG_LEAVE_GAME, nullptr, r) && r.status == ST_OK;
+}
+
+bool run(Session& session) {
+    RequestBody body;
+    Response r;
+    
+    strcpy(body.create.game_name, "solo");
+    body.create.max_players = 1;
+    if (!session.call(MSG_CREATE_GAME, &body, r) || r.status != ST_OK) return fail("create a one-player game");
+    if (!expect_active(session, "created one-player game did not start")) return false;
+    
+    body = RequestBody();
+    body.find.max_players = 1;
+    if (!session.call(MSG_FIND_GAME, &body, r) || r.status != ST_OK) return fail("find a one-player game");
+    return expect_active(session, "matched one-player game did not start");
+}
+
+}
+
+int main() {
+    ShmConfig config;
+    config.max_clients = 1;
+    config.max_games = 2;
+    config.queue_size = 16;
+    Server server(2, config, "", GameTimeouts(), TEST_SHM_NAME);
+    std::thread coordinator(&Server::run, &server);
+    
+    SharedMemory shm(false, ShmConfig(), TEST_SHM_NAME);
+    Session session(shm.root(), "solo");
+    bool ok = session.register_login() && run(session);
+    
+    server.request_stop();
+    coordinator.join();
+    return ok ? 0 : 1;
+}
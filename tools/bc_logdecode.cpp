@@ -0,0 +1,56 @@
+#include "../include/Logger.hpp"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// Prints a binary server log as text.
+//
+//   bc-logdecode file [min_level]      min_level is debug, info, warn or error
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " file [min_level]" << std::endl;
+        return 1;
+    }
+    
+    LogLevel min_level = LOG_DEBUG;
+    if (argc > 2 && !parse_log_level(argv[2], min_level)) {
+        std::cerr << "Unknown level " << argv[2] << std::endl;
+        return 1;
+    }
+    
+    FILE* in = fopen(argv[1], "rb");
+    if (!in) {
+        std::cerr << "Cannot open " << argv[1] << std::endl;
+        return 1;
+    }
+    
+    LogFileHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 ||
+        memcmp(header.magic, LOG_FILE_MAGIC, sizeof(header.magic)) != 0) {
+        std::cerr << argv[1] << " is not a server log" << std::endl;
+        fclose(in);
+        return 1;
+    }
+    if (header.record_size != sizeof(LogRecord)) {
+        std::cerr << argv[1] << " was written with " << header.record_size
+                  << "-byte records, expected " << sizeof(LogRecord) << std::endl;
+        fclose(in);
+        return 1;
+    }
+    
+    LogRecord r;
+    std::string line;
+    while (fread(&r, sizeof(r), 1, in) == 1) {
+        if (r.level < min_level) continue;
+        
+        line.clear();
+        format_log_record(r, line);
+        line += '\n';
+        fwrite(line.data(), 1, line.size(), stdout);
+    }
+    
+    fclose(in);
+    return 0;
+}
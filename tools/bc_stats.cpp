@@ -0,0 +1,195 @@
+#include "../include/SharedMemory.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+// Read-only viewer for the server's stats region.
+//
+//   bc-stats [interval_s]                       live view, refreshed every interval
+//   bc-stats --prometheus path [interval_s]     write Prometheus text to path, once
+//                                               or every interval
+
+namespace {
+
+const char* const STATE_NAMES[] = {"waiting", "active", "finished"};
+
+struct HistSnapshot {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t buckets[HIST_BUCKETS];
+};
+
+struct Snapshot {
+    HistSnapshot types[STATS_TYPES][3];
+    int64_t active_clients;
+    uint64_t reaped_clients;
+    uint64_t journal_dropped;
+    int64_t games[3];
+    uint64_t queue_depth;
+};
+
+void copy(const Histogram& h, HistSnapshot& out) {
+    out.count = h.count.load(std::memory_order_relaxed);
+    out.sum = h.sum.load(std::memory_order_relaxed);
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        out.buckets[b] = h.buckets[b].load(std::memory_order_relaxed);
+    }
+}
+
+void take(SharedMemoryRoot* root, Snapshot& s) {
+    StatsRegion* stats = root->stats();
+    for (int t = 0; t < STATS_TYPES; t++) {
+        copy(stats->types[t].queue_wait, s.types[t][0]);
+        copy(stats->types[t].handler, s.types[t][1]);
+        copy(stats->types[t].delivery, s.types[t][2]);
+    }
+    s.active_clients = stats->active_clients.load(std::memory_order_relaxed);
+    s.reaped_clients = stats->reaped_clients.load(std::memory_order_relaxed);
+    s.journal_dropped = stats->journal_dropped.load(std::memory_order_relaxed);
+    for (int i = 0; i < 3; i++) {
+        s.games[i] = stats->games_by_state[i].load(std::memory_order_relaxed);
+    }
+    s.queue_depth = root->queue.tail.load(std::memory_order_relaxed) - root->queue.head.load(std::memory_order_relaxed);
+}
+
+// Samples recorded between two snapshots.
+HistSnapshot delta(const HistSnapshot& before, const HistSnapshot& after) {
+    HistSnapshot d;
+    d.count = after.count - before.count;
+    d.sum = after.sum - before.sum;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        d.buckets[b] = after.buckets[b] - before.buckets[b];
+    }
+    return d;
+}
+
+double us(uint64_t ns) {
+    return ns / 1000.0;
+}
+
+void show(const Snapshot& before, const Snapshot& after, double seconds) {
+    static const char* const METRICS[] = {"queue", "handler", "deliver"};
+    
+    printf("\033[H\033[2J");
+    printf("clients: %lld (%llu reaped)   queue depth: %llu   games: %lld waiting, %lld active, %lld finished\n",
+           (long long)after.active_clients, (unsigned long long)after.reaped_clients,
+           (unsigned long long)after.queue_depth,
+           (long long)after.games[0], (long long)after.games[1], (long long)after.games[2]);
+    if (after.journal_dropped) {
+        printf("JOURNAL FULL: %llu records dropped\n", (unsigned long long)after.journal_dropped);
+    }
+    printf("\n");
+    printf("%-12s %-8s %10s %10s %10s %10s %10s\n", "type", "metric", "rate/s", "p50 us", "p99 us", "p999 us", "total");
+    
+    for (int t = 0; t < STATS_TYPES; t++) {
+        if (after.types[t][1].count == 0) continue;
+        
+        for (int k = 0; k < 3; k++) {
+            HistSnapshot d = delta(before.types[t][k], after.types[t][k]);
+            printf("%-12s %-8s %10.1f %10.1f %10.1f %10.1f %10llu\n", k == 0 ? msg_type_name(t) : "",
+                   METRICS[k], d.count / seconds,
+                   us(hist_percentile(d.buckets, d.count, 0.5)),
+                   us(hist_percentile(d.buckets, d.count, 0.99)),
+                   us(hist_percentile(d.buckets, d.count, 0.999)),
+                   (unsigned long long)after.types[t][k].count);
+        }
+    }
+    fflush(stdout);
+}
+
+void write_histogram(std::ostream& out, const char* metric, const char* type, const HistSnapshot& h) {
+    uint64_t cumulative = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        if (h.buckets[b] == 0) continue;
+        cumulative += h.buckets[b];
+        
+        // A bucket's upper bound is the next bucket's floor.
+        double le = (b + 1 < HIST_BUCKETS ? hist_bucket_floor(b + 1) : hist_bucket_floor(b) * 2) / 1e9;
+        out << metric << "_bucket{type=\"" << type << "\",le=\"" << le << "\"} " << cumulative << "\n";
+    }
+    out << metric << "_bucket{type=\"" << type << "\",le=\"+Inf\"} " << h.count << "\n";
+    out << metric << "_sum{type=\"" << type << "\"} " << h.sum / 1e9 << "\n";
+    out << metric << "_count{type=\"" << type << "\"} " << h.count << "\n";
+}
+
+// Written to a temporary file and renamed, so a collector never sees a
+// half-written file.
+bool write_prometheus(const Snapshot& s, const std::string& path) {
+    static const char* const METRICS[] = {
+        "bc_queue_wait_seconds", "bc_handler_seconds", "bc_delivery_seconds"
+    };
+    
+    std::string tmp = path + ".tmp";
+    std::ofstream out(tmp);
+    if (!out) return false;
+    
+    out << "# TYPE bc_active_clients gauge\nbc_active_clients " << s.active_clients << "\n";
+    out << "# TYPE bc_reaped_clients_total counter\nbc_reaped_clients_total " << s.reaped_clients << "\n";
+    out << "# TYPE bc_journal_dropped_total counter\nbc_journal_dropped_total " << s.journal_dropped << "\n";
+    out << "# TYPE bc_queue_depth gauge\nbc_queue_depth " << s.queue_depth << "\n";
+    out << "# TYPE bc_games gauge\n";
+    for (int i = 0; i < 3; i++) {
+        out << "bc_games{state=\"" << STATE_NAMES[i] << "\"} " << s.games[i] << "\n";
+    }
+    
+    for (int k = 0; k < 3; k++) {
+        out << "# TYPE " << METRICS[k] << " histogram\n";
+        for (int t = 0; t < STATS_TYPES; t++) {
+            if (s.types[t][k].count == 0) continue;
+            write_histogram(out, METRICS[k], msg_type_name(t), s.types[t][k]);
+        }
+    }
+    
+    out.close();
+    return out && rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+}
+
+int main(int argc, char** argv) {
+    const char* prometheus = nullptr;
+    double interval = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--prometheus") == 0 && i + 1 < argc) {
+            prometheus = argv[++i];
+        } else {
+            interval = std::strtod(argv[i], nullptr);
+        }
+    }
+    if (!prometheus && interval <= 0) interval = 1;
+    
+    try {
+        SharedMemory shm(false, ShmConfig(), SHM_NAME, true);
+        SharedMemoryRoot* root = shm.root();
+        
+        auto before = std::make_unique<Snapshot>();
+        auto after = std::make_unique<Snapshot>();
+        take(root, *before);
+        
+        while (true) {
+            if (prometheus && !write_prometheus(*before, prometheus)) {
+                std::cerr << "Failed to write " << prometheus << std::endl;
+                return 1;
+            }
+            if (interval <= 0) break;
+            
+            std::this_thread::sleep_for(std::chrono::duration<double>(interval));
+            take(root, *after);
+            if (!prometheus) {
+                show(*before, *after, interval);
+            }
+            std::swap(before, after);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    
+    return 0;
+}